@@ -16,6 +16,7 @@
 #include <cstring>
 
 #include <vector>
+#include <algorithm>
 
 #include "SDL_gfxPrimitivesDirty.h"
 #include "SDL_gfxPrimitives_font.h"
@@ -34,8 +35,29 @@
 
 SDL_Surface* dirtyDst = NULL;
 SDL_Surface* dirtyBackground = NULL;
-std::vector<Uint8*> dirtyPixels;
-std::vector<SDL_Rect> dirtyRects;
+
+// Dirtiness is tracked per tile of DIRTY_TILE_SIZE x DIRTY_TILE_SIZE pixels,
+// one byte per tile; blankDirty restores each horizontal run of dirty tiles
+// a scanline at a time.
+#define DIRTY_TILE_SHIFT 4
+#define DIRTY_TILE_SIZE (1 << DIRTY_TILE_SHIFT)
+
+std::vector<Uint8> dirtyTiles;
+int dirtyTilesW = 0;
+int dirtyTilesH = 0;
+// bytes covered by a row of tiles, and by a tile's width within a scanline
+int dirtyTileRowBytes = 1;
+int dirtyTileColBytes = 1;
+
+std::vector<SDL_Rect> restoredRects;
+long restoredArea = 0;
+
+// restoredTiles: the tiles restored by the last blankDirty. allChanged: set
+// by setDirty, until the next blankDirty, to report the whole surface as
+// changed.
+std::vector<Uint8> restoredTiles;
+bool allChanged = false;
+std::vector<SDL_Rect> changedRects;
 
 // Set surface to accumulate dirtiness information for subsequent calls to
 // blankDirty, which will then redraw the background over dirtied pixels.
@@ -45,8 +67,90 @@ void setDirty(SDL_Surface* dst, SDL_Surface* background)
 {
     dirtyDst = dst;
     dirtyBackground = background;
-    dirtyPixels.clear();
-    dirtyRects.clear();
+    restoredRects.clear();
+    restoredArea = 0;
+    if (!dst)
+	return;
+    dirtyTilesW = (dst->w + DIRTY_TILE_SIZE-1) >> DIRTY_TILE_SHIFT;
+    dirtyTilesH = (dst->h + DIRTY_TILE_SIZE-1) >> DIRTY_TILE_SHIFT;
+    dirtyTileRowBytes = dst->pitch << DIRTY_TILE_SHIFT;
+    dirtyTileColBytes = dst->format->BytesPerPixel << DIRTY_TILE_SHIFT;
+    dirtyTiles.assign(dirtyTilesW*dirtyTilesH, 0);
+    restoredTiles.assign(dirtyTilesW*dirtyTilesH, 0);
+    allChanged = true;
+}
+
+// markDirty: mark the pixel at p in dirtyDst as dirty
+static inline void markDirty(const Uint8* p)
+{
+    const int offset = p - (Uint8*)dirtyDst->pixels;
+    const int row = offset / dirtyTileRowBytes;
+    const int col = (offset % dirtyDst->pitch) / dirtyTileColBytes;
+    dirtyTiles[row*dirtyTilesW + col] = 1;
+}
+
+// markDirtyXY: mark the pixel (x,y), which must be on dirtyDst, as dirty
+static inline void markDirtyXY(int x, int y)
+{
+    dirtyTiles[(y >> DIRTY_TILE_SHIFT)*dirtyTilesW + (x >> DIRTY_TILE_SHIFT)] = 1;
+}
+
+// markDirtyRect: mark the pixels in the inclusive rectangle (x1,y1)-(x2,y2)
+// of dirtyDst as dirty, clipping to the surface
+static void markDirtyRect(int x1, int y1, int x2, int y2)
+{
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    x1 = std::max(x1, 0);
+    y1 = std::max(y1, 0);
+    x2 = std::min(x2, dirtyDst->w - 1);
+    y2 = std::min(y2, dirtyDst->h - 1);
+    if (x1 > x2 || y1 > y2)
+	return;
+    for (int row = y1 >> DIRTY_TILE_SHIFT; row <= y2 >> DIRTY_TILE_SHIFT;
+	    row++)
+	memset(&dirtyTiles[row*dirtyTilesW + (x1 >> DIRTY_TILE_SHIFT)], 1,
+		(x2 >> DIRTY_TILE_SHIFT) - (x1 >> DIRTY_TILE_SHIFT) + 1);
+}
+
+static void markDirtyRect(const SDL_Rect& rect)
+{
+    markDirtyRect(rect.x, rect.y, rect.x + rect.w - 1, rect.y + rect.h - 1);
+}
+
+// getRuns: append to rects the runs of tiles in each row of tiles which are
+// set in 'tiles' or, if it is non-NULL, in 'orTiles', clipped to the
+// surface; returns their total area in pixels
+static long getRuns(const std::vector<Uint8>& tiles,
+	const std::vector<Uint8>* orTiles, std::vector<SDL_Rect>& rects)
+{
+    long area = 0;
+    for (int row = 0; row < dirtyTilesH; row++)
+    {
+	const Uint8* t = &tiles[row*dirtyTilesW];
+	const Uint8* o = orTiles ? &(*orTiles)[row*dirtyTilesW] : NULL;
+	int col = 0;
+	while (col < dirtyTilesW)
+	{
+	    if (!(t[col] || (o && o[col])))
+	    {
+		col++;
+		continue;
+	    }
+	    const int first = col;
+	    while (col < dirtyTilesW && (t[col] || (o && o[col])))
+		col++;
+
+	    SDL_Rect rect;
+	    rect.x = first << DIRTY_TILE_SHIFT;
+	    rect.y = row << DIRTY_TILE_SHIFT;
+	    rect.w = std::min(col << DIRTY_TILE_SHIFT, (int)dirtyDst->w) - rect.x;
+	    rect.h = std::min((row+1) << DIRTY_TILE_SHIFT, (int)dirtyDst->h) - rect.y;
+	    rects.push_back(rect);
+	    area += rect.w * rect.h;
+	}
+    }
+    return area;
 }
 
 int blankDirty()
@@ -54,6 +158,9 @@ int blankDirty()
     if (!dirtyDst)
 	return -1;
 
+    restoredRects.clear();
+    restoredArea = getRuns(dirtyTiles, NULL, restoredRects);
+
     /*
      * Lock the surface 
      */
@@ -62,70 +169,102 @@ int blankDirty()
 	    return (-1);
 	}
     }
+    if (dirtyBackground && SDL_MUSTLOCK(dirtyBackground)) {
+	if (SDL_LockSurface(dirtyBackground) < 0) {
+	    if (SDL_MUSTLOCK(dirtyDst))
+		SDL_UnlockSurface(dirtyDst);
+	    return (-1);
+	}
+    }
 
-    const Uint32 black = 0;
-
-    while (!dirtyPixels.empty())
+    // the background is black, or the same format as dirtyDst, so each
+    // scanline of a run can be restored with a single copy
+    const int bpp = dirtyDst->format->BytesPerPixel;
+    for (std::vector<SDL_Rect>::const_iterator it = restoredRects.begin();
+	    it != restoredRects.end();
+	    it++)
     {
-	Uint8* p = dirtyPixels.back();
-	dirtyPixels.pop_back();
-	int bpp = dirtyDst->format->BytesPerPixel;
-	if (dirtyBackground)
-	{
-	    const Uint8* bp = (Uint8*)dirtyBackground->pixels + (p -
-		    (Uint8*)dirtyDst->pixels);
-	    for (int i=0; i<bpp; i++)
-		*(p+i) = *(bp+i);
-	}
-	else
+	const int offset = it->y * dirtyDst->pitch + it->x * bpp;
+	const int bytes = it->w * bpp;
+	Uint8* p = (Uint8*)dirtyDst->pixels + offset;
+	const Uint8* bp = dirtyBackground ?
+	    (Uint8*)dirtyBackground->pixels + offset : NULL;
+	for (int y = 0; y < it->h; y++)
 	{
-	    switch (bpp) {
-		case 1:
-		    *p = black;
-		    break;
-		case 2:
-		    *(Uint16 *) p = black;
-		    break;
-		case 3:
-		    {
-			if (SDL_BYTEORDER == SDL_BIG_ENDIAN) {
-			    p[0] = (black >> 16) & 0xff;
-			    p[1] = (black >> 8) & 0xff;
-			    p[2] = black & 0xff;
-			} else {
-			    p[0] = black & 0xff;
-			    p[1] = (black >> 8) & 0xff;
-			    p[2] = (black >> 16) & 0xff;
-			}
-		    }
-		    break;
-		case 4:
-		    *(Uint32 *) p = black;
-		    break;
-	    }			/* switch */
+	    if (bp)
+	    {
+		memcpy(p, bp, bytes);
+		bp += dirtyBackground->pitch;
+	    }
+	    else
+		memset(p, 0, bytes);
+	    p += dirtyDst->pitch;
 	}
     }
 
     /*
-     * Unlock the surface 
+     * Unlock the surfaces 
      */
+    if (dirtyBackground && SDL_MUSTLOCK(dirtyBackground)) {
+	SDL_UnlockSurface(dirtyBackground);
+    }
     if (SDL_MUSTLOCK(dirtyDst)) {
 	SDL_UnlockSurface(dirtyDst);
     }
 
-    while (!dirtyRects.empty())
-    {
-	SDL_Rect rect = dirtyRects.back();
-	dirtyRects.pop_back();
-	if (dirtyBackground)
-	    SDL_BlitSurface(dirtyBackground, &rect, dirtyDst, &rect);
-	else
-	    SDL_FillRect(dirtyDst, &rect, 0);
-    }
+    restoredTiles.swap(dirtyTiles);
+    std::fill(dirtyTiles.begin(), dirtyTiles.end(), 0);
+    allChanged = false;
 
     return 0;
 }
 
+int getRestoredRects(const SDL_Rect** rects)
+{
+    *rects = restoredRects.empty() ? NULL : &restoredRects[0];
+    return restoredRects.size();
+}
+
+long getRestoredArea()
+{
+    return restoredArea;
+}
+
+int getChangedRects(SDL_Rect** rects, long* area)
+{
+    changedRects.clear();
+    if (!dirtyDst)
+	*area = 0;
+    else if (allChanged)
+    {
+	SDL_Rect all;
+	all.x = all.y = 0;
+	all.w = dirtyDst->w;
+	all.h = dirtyDst->h;
+	changedRects.push_back(all);
+	*area = long(all.w) * all.h;
+    }
+    else
+	*area = getRuns(dirtyTiles, &restoredTiles, changedRects);
+    *rects = changedRects.empty() ? NULL : &changedRects[0];
+    return changedRects.size();
+}
+
+int blitDirty(SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst,
+	SDL_Rect* dstrect)
+{
+    if (dirtyDst == dst)
+    {
+	SDL_Rect rect;
+	rect.x = dstrect ? dstrect->x : 0;
+	rect.y = dstrect ? dstrect->y : 0;
+	rect.w = srcrect ? srcrect->w : src->w;
+	rect.h = srcrect ? srcrect->h : src->h;
+	markDirtyRect(rect);
+    }
+    return SDL_BlitSurface(src, srcrect, dst, dstrect);
+}
+
 /* ----- Pixel - fast, no blending, no locking, clipping */
 
 int fastPixelColorNolock(SDL_Surface * dst, Sint16 x, Sint16 y, Uint32 color)
@@ -144,7 +283,7 @@ int fastPixelColorNolock(SDL_Surface * dst, Sint16 x, Sint16 y, Uint32 color)
 	bpp = dst->format->BytesPerPixel;
 	p = (Uint8 *) dst->pixels + y * dst->pitch + x * bpp;
 	if (dirtyDst == dst)
-	    dirtyPixels.push_back(p);
+	    markDirtyXY(x, y);
 	switch (bpp) {
 	case 1:
 	    *p = color;
@@ -189,7 +328,7 @@ int fastPixelColorNolockNoclip(SDL_Surface * dst, Sint16 x, Sint16 y, Uint32 col
     bpp = dst->format->BytesPerPixel;
     p = (Uint8 *) dst->pixels + y * dst->pitch + x * bpp;
     if (dirtyDst == dst)
-	dirtyPixels.push_back(p);
+	markDirtyXY(x, y);
     switch (bpp) {
     case 1:
 	*p = color;
@@ -292,9 +431,7 @@ int _putPixelAlpha(SDL_Surface * surface, Sint16 x, Sint16 y, Uint32 color, Uint
 	&& y >= clip_ymin(surface) && y <= clip_ymax(surface)) {
 
 	if (dirtyDst == surface)
-	    dirtyPixels.push_back(
-		    (Uint8 *) surface->pixels + y * surface->pitch +
-		    x * surface->format->BytesPerPixel);
+	    markDirtyXY(x, y);
 
 	switch (surface->format->BytesPerPixel) {
 	case 1:{		/* Assuming 8-bpp */
@@ -480,6 +617,9 @@ int _filledRectAlpha(SDL_Surface * surface, Sint16 x1, Sint16 y1, Sint16 x2, Sin
     Uint32 R, G, B, A = 0;
     Sint16 x, y;
 
+    if (dirtyDst == surface)
+	markDirtyRect(x1, y1, x2, y2);
+
     switch (surface->format->BytesPerPixel) {
     case 1:{			/* Assuming 8-bpp */
 	    Uint8 *row, *pixel;
@@ -503,8 +643,6 @@ int _filledRectAlpha(SDL_Surface * surface, Sint16 x1, Sint16 y1, Sint16 x2, Sin
 		    dB = dB + ((sB - dB) * alpha >> 8);
 
 		    *pixel = SDL_MapRGB(surface->format, dR, dG, dB);
-		    if (dirtyDst == surface)
-			dirtyPixels.push_back(pixel);
 		}
 	    }
 	}
@@ -526,8 +664,6 @@ int _filledRectAlpha(SDL_Surface * surface, Sint16 x1, Sint16 y1, Sint16 x2, Sin
 			A = ((*pixel & Amask) + ((dA - (*pixel & Amask)) * alpha >> 8)) & Amask;
 
 		    *pixel = R | G | B | A;
-		    if (dirtyDst == surface)
-			dirtyPixels.push_back( (Uint8*) pixel );
 		}
 	    }
 	}
@@ -565,8 +701,6 @@ int _filledRectAlpha(SDL_Surface * surface, Sint16 x1, Sint16 y1, Sint16 x2, Sin
 		    *((pix) + gshift8) = dG;
 		    *((pix) + bshift8) = dB;
 		    *((pix) + ashift8) = dA;
-		    if (dirtyDst == surface)
-			dirtyPixels.push_back(pix);
 		}
 	    }
 
@@ -596,8 +730,6 @@ int _filledRectAlpha(SDL_Surface * surface, Sint16 x1, Sint16 y1, Sint16 x2, Sin
 			A = ((*pixel & Amask) + ((((dA - (*pixel & Amask)) >> Ashift) * alpha >> 8) << Ashift)) & Amask;
 
 		    *pixel = R | G | B | A;
-		    if (dirtyDst == surface)
-			dirtyPixels.push_back( (Uint8*) pixel );
 		}
 	    }
 	}
@@ -636,8 +768,6 @@ int _filledRectAlpha(SDL_Surface * surface, Sint16 x1, Sint16 y1, Sint16 x2, Sin
 		    if (Amask)
 			A = (preMultA + (aTmp * ((dc & Amask) >> Ashift))) >> 8 << Ashift & Amask;
 		    *pixel = R | G | B | A;
-		    if (dirtyDst == surface)
-			dirtyPixels.push_back(pixel);
 		}
 	    }
 	}
@@ -849,9 +979,8 @@ int hlineColorStore(SDL_Surface * dst, Sint16 x1, Sint16 x2, Sint16 y, Uint32 co
 	pixy = dst->pitch;
 	pixel = ((Uint8 *) dst->pixels) + pixx * (int) x1 + pixy * (int) y;
 	pixellast = pixel + dx * pixx;
-	for (Uint8* tpixel = pixel; tpixel <= pixellast; tpixel += pixx)
-	    if (dirtyDst == dst)
-		dirtyPixels.push_back(tpixel);
+	if (dirtyDst == dst)
+	    markDirtyRect(x1, y, x1 + w, y);
 
 	/*
 	 * Draw 
@@ -998,9 +1127,8 @@ int hlineColor(SDL_Surface * dst, Sint16 x1, Sint16 x2, Sint16 y, Uint32 color)
 	pixy = dst->pitch;
 	pixel = ((Uint8 *) dst->pixels) + pixx * (int) x1 + pixy * (int) y;
 	pixellast = pixel + dx * dst->format->BytesPerPixel;
-	for (Uint8* tpixel = pixel; tpixel <= pixellast; tpixel += pixx)
-	    if (dirtyDst == dst)
-		dirtyPixels.push_back(tpixel);
+	if (dirtyDst == dst)
+	    markDirtyRect(x1, y, x1 + w, y);
 
 	/*
 	 * Draw 
@@ -1160,9 +1288,8 @@ int vlineColor(SDL_Surface * dst, Sint16 x, Sint16 y1, Sint16 y2, Uint32 color)
 	pixy = dst->pitch;
 	pixel = ((Uint8 *) dst->pixels) + pixx * (int) x + pixy * (int) y1;
 	pixellast = pixel + pixy * dy;
-	for (Uint8* tpixel = pixel; tpixel <= pixellast; tpixel += pixy)
-	    if (dirtyDst == dst)
-		dirtyPixels.push_back(tpixel);
+	if (dirtyDst == dst)
+	    markDirtyRect(x, y1, x, y1 + h);
 
 	/*
 	 * Draw 
@@ -1541,13 +1668,8 @@ int boxColor(SDL_Surface * dst, Sint16 x1, Sint16 y1, Sint16 x2, Sint16 y2, Uint
 	pixellast = pixel + pixx * dx + pixy * dy;
 	dx++;
 
-	for (Uint8* tpixel = pixel; tpixel <= pixellast; tpixel += pixy)
-	    for (x = 0; x < dx; x++)
-	    {
-		if (dirtyDst == dst)
-		    dirtyPixels.push_back(tpixel);
-		tpixel += pixx;
-	    }
+	if (dirtyDst == dst)
+	    markDirtyRect(x1, y1, x1 + w, y1 + h);
 	
 	/*
 	 * Draw 
@@ -1728,7 +1850,7 @@ int lineColor(SDL_Surface * dst, Sint16 x1, Sint16 y1, Sint16 x2, Sint16 y2, Uin
 	    for (; x < dx; x++, pixel += pixx) {
 		*pixel = color;
 		if (dirtyDst == dst)
-		    dirtyPixels.push_back(pixel);
+		    markDirty((Uint8*) pixel);
 		y += dy;
 		if (y >= dx) {
 		    y -= dx;
@@ -1740,7 +1862,7 @@ int lineColor(SDL_Surface * dst, Sint16 x1, Sint16 y1, Sint16 x2, Sint16 y2, Uin
 	    for (; x < dx; x++, pixel += pixx) {
 		*(Uint16 *) pixel = color;
 		if (dirtyDst == dst)
-		    dirtyPixels.push_back(pixel);
+		    markDirty((Uint8*) pixel);
 		y += dy;
 		if (y >= dx) {
 		    y -= dx;
@@ -1760,7 +1882,7 @@ int lineColor(SDL_Surface * dst, Sint16 x1, Sint16 y1, Sint16 x2, Sint16 y2, Uin
 		    pixel[2] = (color >> 16) & 0xff;
 		}
 		if (dirtyDst == dst)
-		    dirtyPixels.push_back(pixel);
+		    markDirty((Uint8*) pixel);
 		y += dy;
 		if (y >= dx) {
 		    y -= dx;
@@ -1772,7 +1894,7 @@ int lineColor(SDL_Surface * dst, Sint16 x1, Sint16 y1, Sint16 x2, Sint16 y2, Uin
 	    for (; x < dx; x++, pixel += pixx) {
 		*(Uint32 *) pixel = color;
 		if (dirtyDst == dst)
-		    dirtyPixels.push_back(pixel);
+		    markDirty((Uint8*) pixel);
 		y += dy;
 		if (y >= dx) {
 		    y -= dx;
@@ -4216,8 +4338,10 @@ int _texturedHLine(SDL_Surface * dst, Sint16 x1, Sint16 x2, Sint16 y,SDL_Surface
       source_rect.w = w;
       source_rect.x = texture_x_walker;
       dst_rect.x= x1;
+      dst_rect.w = source_rect.w;
+      dst_rect.h = 1;
       if (dirtyDst == dst)
-	  dirtyRects.push_back(dst_rect);
+	  markDirtyRect(dst_rect);
       SDL_BlitSurface  (texture,&source_rect , dst, &dst_rect) ;
     } else {//we need to draw multiple times
       //draw the first segment
@@ -4225,8 +4349,10 @@ int _texturedHLine(SDL_Surface * dst, Sint16 x1, Sint16 x2, Sint16 y,SDL_Surface
       source_rect.w = pixels_written;
       source_rect.x = texture_x_walker;
       dst_rect.x= x1;
+      dst_rect.w = source_rect.w;
+      dst_rect.h = 1;
       if (dirtyDst == dst)
-	  dirtyRects.push_back(dst_rect);
+	  markDirtyRect(dst_rect);
       SDL_BlitSurface  (texture,&source_rect , dst, &dst_rect);
       write_width = texture->w;
 
@@ -4239,8 +4365,10 @@ int _texturedHLine(SDL_Surface * dst, Sint16 x1, Sint16 x2, Sint16 y,SDL_Surface
         }
         source_rect.w = write_width;
         dst_rect.x = x1 + pixels_written;
+	dst_rect.w = source_rect.w;
+	dst_rect.h = 1;
 	if (dirtyDst == dst)
-	    dirtyRects.push_back(dst_rect);
+	    markDirtyRect(dst_rect);
         SDL_BlitSurface  (texture,&source_rect , dst, &dst_rect) ;
         pixels_written += write_width;
       }
@@ -4437,8 +4565,31 @@ int gfxPrimitivesCompareInt(const void *a, const void *b)
 
 /* ---- Character */
 
-static SDL_Surface *gfxPrimitivesFont[256];
-static Uint32 gfxPrimitivesFontColor[256];
+/*
+ * Glyphs are kept in atlases, one for each font and colour in use: a
+ * surface holding the font's 256 glyphs in a 16x16 grid, each rendered the
+ * first time it is drawn. Once a font and colour have been seen, switching
+ * to them costs nothing and drawing a character is a single blit. When
+ * every atlas is taken, the least recently used is dropped.
+ */
+
+#define GLYPH_ATLASES 32
+
+typedef struct {
+    const unsigned char *fontdata;	/* NULL if the atlas is unused */
+    int cw, ch;
+    Uint32 color;
+    SDL_Surface *surface;
+    Uint32 rendered[8];		/* bit c set once glyph c is drawn */
+    unsigned long lastUse;
+} GlyphAtlas;
+
+static GlyphAtlas glyphAtlases[GLYPH_ATLASES];
+static GlyphAtlas *lastAtlas = NULL;
+static unsigned long glyphAtlasClock = 0;
+
+/* glyphs drawn from an atlas, and glyphs which had first to be rendered */
+static unsigned long glyphHits = 0, glyphMisses = 0;
 
 /* Default is to use 8x8 internal font */
 static const unsigned char *currentFontdata = gfxPrimitivesFontdata;
@@ -4449,8 +4600,6 @@ static int charSize = 8;	/* character data size in bytes */
 
 void gfxPrimitivesSetFont(const void *fontdata, int cw, int ch)
 {
-    int i;
-
     if (fontdata) {
         currentFontdata = (const unsigned char*) fontdata;
         charWidth = cw;
@@ -4463,156 +4612,170 @@ void gfxPrimitivesSetFont(const void *fontdata, int cw, int ch)
 
     charPitch = (charWidth+7)/8;
     charSize = charPitch * charHeight;
+}
 
-    for (i = 0; i < 256; i++) {
-	if (gfxPrimitivesFont[i]) {
-	    SDL_FreeSurface(gfxPrimitivesFont[i]);
-	    gfxPrimitivesFont[i] = NULL;
+void gfxPrimitivesGlyphStats(unsigned long *hits, unsigned long *misses)
+{
+    *hits = glyphHits;
+    *misses = glyphMisses;
+}
+
+/* the atlas for the current font in 'color', made if need be */
+static GlyphAtlas *glyphAtlas(Uint32 color)
+{
+    GlyphAtlas *atlas = lastAtlas;
+    int i;
+
+    if (atlas == NULL || atlas->fontdata != currentFontdata ||
+	    atlas->cw != charWidth || atlas->ch != charHeight ||
+	    atlas->color != color) {
+	atlas = NULL;
+	for (i = 0; i < GLYPH_ATLASES; i++) {
+	    GlyphAtlas *a = &glyphAtlases[i];
+	    if (a->fontdata == currentFontdata && a->cw == charWidth &&
+		    a->ch == charHeight && a->color == color) {
+		atlas = a;
+		break;
+	    }
+	}
+
+	if (atlas == NULL) {
+	    /* take an unused atlas, or else the least recently used */
+	    atlas = &glyphAtlases[0];
+	    for (i = 1; i < GLYPH_ATLASES && atlas->fontdata; i++) {
+		if (!glyphAtlases[i].fontdata ||
+			glyphAtlases[i].lastUse < atlas->lastUse)
+		    atlas = &glyphAtlases[i];
+	    }
+	    if (atlas->surface)
+		SDL_FreeSurface(atlas->surface);
+
+	    atlas->surface =
+		SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_SRCALPHA,
+			16*charWidth, 16*charHeight, 32,
+			0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
+	    if (atlas->surface == NULL) {
+		atlas->fontdata = NULL;
+		lastAtlas = NULL;
+		return NULL;
+	    }
+	    SDL_SetAlpha(atlas->surface, SDL_SRCALPHA, 255);
+	    atlas->fontdata = currentFontdata;
+	    atlas->cw = charWidth;
+	    atlas->ch = charHeight;
+	    atlas->color = color;
+	    memset(atlas->rendered, 0, sizeof(atlas->rendered));
 	}
+	lastAtlas = atlas;
     }
+
+    atlas->lastUse = ++glyphAtlasClock;
+    return atlas;
 }
 
-int characterColor(SDL_Surface * dst, Sint16 x, Sint16 y, char c, Uint32 color)
+/* render glyph c into its place in the atlas */
+static int renderGlyph(GlyphAtlas *atlas, unsigned char c)
 {
-    Sint16 left, right, top, bottom;
-    Sint16 x1, y1, x2, y2;
-    SDL_Rect srect;
-    SDL_Rect drect;
-    int result;
-    int ix, iy;
+    SDL_Surface *surface = atlas->surface;
     const unsigned char *charpos;
-    Uint8 *curpos;
-    int forced_redraw;
+    Uint8 *curpos, *linepos;
     Uint8 patt, mask;
-    Uint8 *linepos;
-    int pitch;
+    int ix, iy;
 
-    /*
-     * Check visibility of clipping rectangle
-     */
-    if ((dst->clip_rect.w==0) || (dst->clip_rect.h==0)) {
-     return(0);
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) != 0)
+	return (-1);
+
+    charpos = currentFontdata + c * charSize;
+    linepos = (Uint8 *) surface->pixels +
+	(c / 16) * charHeight * surface->pitch + (c % 16) * charWidth * 4;
+
+    patt = 0;
+    for (iy = 0; iy < charHeight; iy++) {
+	mask = 0x00;
+	curpos = linepos;
+	for (ix = 0; ix < charWidth; ix++) {
+	    if (!(mask >>= 1)) {
+		patt = *charpos++;
+		mask = 0x80;
+	    }
+
+	    if (patt & mask)
+		*(Uint32 *)curpos = atlas->color;
+	    else
+		*(Uint32 *)curpos = 0;
+	    curpos += 4;
+	}
+	linepos += surface->pitch;
     }
 
-    /*
-     * Get text and clipping boundary and
-     * test if bounding box of character is visible 
-     */
+    if (SDL_MUSTLOCK(surface))
+	SDL_UnlockSurface(surface);
 
-    left = dst->clip_rect.x;
-    x2 = x + charWidth;
-    if (x2<left) {
-     return(0);
-    } 
-    right = dst->clip_rect.x + dst->clip_rect.w - 1;
-    x1 = x;
-    if (x1>right) {
-     return(0);
-    } 
-    top = dst->clip_rect.y;
-    y2 = y + charHeight;
-    if (y2<top) {
-     return(0);
-    } 
-    bottom = dst->clip_rect.y + dst->clip_rect.h - 1;
-    y1 = y;
-    if (y1>bottom) {
-     return(0);
-    } 
+    atlas->rendered[c / 32] |= (Uint32) 1 << (c % 32);
+    return (0);
+}
+
+/* make sure glyph c is in the atlas, counting a hit or miss */
+static int needGlyph(GlyphAtlas *atlas, unsigned char c)
+{
+    if (atlas->rendered[c / 32] & ((Uint32) 1 << (c % 32))) {
+	glyphHits++;
+	return (0);
+    }
+    glyphMisses++;
+    return (renderGlyph(atlas, c));
+}
+
+/* draw glyph c of the atlas at (x,y) */
+static int blitGlyph(SDL_Surface * dst, GlyphAtlas *atlas, Sint16 x, Sint16 y,
+	unsigned char c)
+{
+    SDL_Rect srect;
+    SDL_Rect drect;
 
     /*
-     * Setup source rectangle
+     * Test if bounding box of character is visible
      */
-    srect.x = 0;
-    srect.y = 0;
+    if (x + charWidth < dst->clip_rect.x ||
+	    x > dst->clip_rect.x + dst->clip_rect.w - 1 ||
+	    y + charHeight < dst->clip_rect.y ||
+	    y > dst->clip_rect.y + dst->clip_rect.h - 1)
+	return (0);
+
+    if (needGlyph(atlas, c) != 0)
+	return (-1);
+
+    srect.x = (c % 16) * charWidth;
+    srect.y = (c / 16) * charHeight;
     srect.w = charWidth;
     srect.h = charHeight;
 
-    /*
-     * Setup destination rectangle
-     */
     drect.x = x;
     drect.y = y;
     drect.w = charWidth;
     drect.h = charHeight;
 
-    /*
-     * Create new charWidth x charHeight bitmap surface if not already present 
-     */
-    if (gfxPrimitivesFont[(unsigned char) c] == NULL) {
-	gfxPrimitivesFont[(unsigned char) c] =
-	    SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_HWSURFACE | SDL_SRCALPHA,
-                                 charWidth, charHeight, 32,
-				 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
-	/*
-	 * Check pointer 
-	 */
-	if (gfxPrimitivesFont[(unsigned char) c] == NULL) {
-	    return (-1);
-	}
-	/*
-	 * Definitely redraw 
-	 */
-	forced_redraw = 1;
-    } else {
-	forced_redraw = 0;
-    }
+    if (dirtyDst == dst)
+	markDirtyRect(drect);
+    return (SDL_BlitSurface(atlas->surface, &srect, dst, &drect));
+}
+
+int characterColor(SDL_Surface * dst, Sint16 x, Sint16 y, char c, Uint32 color)
+{
+    GlyphAtlas *atlas;
 
     /*
-     * Check if color has changed 
+     * Check visibility of clipping rectangle
      */
-    if ((gfxPrimitivesFontColor[(unsigned char) c] != color) || (forced_redraw)) {
-	/*
-	 * Redraw character 
-	 */
-	SDL_SetAlpha(gfxPrimitivesFont[(unsigned char) c], SDL_SRCALPHA, 255);
-	gfxPrimitivesFontColor[(unsigned char) c] = color;
-
-	/* Lock font-surface */
-	if (SDL_LockSurface(gfxPrimitivesFont[(unsigned char) c]) != 0)
-	    return (-1);
-
-	/*
-	 * Variable setup 
-	 */
-	charpos = currentFontdata + (unsigned char) c * charSize;
-	linepos = (Uint8 *) gfxPrimitivesFont[(unsigned char) c]->pixels;
-	pitch = gfxPrimitivesFont[(unsigned char) c]->pitch;
-
-	/*
-	 * Drawing loop 
-	 */
-        patt = 0;
-	for (iy = 0; iy < charHeight; iy++) {
-            mask = 0x00;
-	    curpos = linepos;
-	    for (ix = 0; ix < charWidth; ix++) {
-		if (!(mask >>= 1)) {
-		    patt = *charpos++;
-		    mask = 0x80;
-		}
-
-		if (patt & mask)
-		    *(Uint32 *)curpos = color;
-		else
-		    *(Uint32 *)curpos = 0;
-		curpos += 4;;
-	    }
-	    linepos += pitch;
-	}
-
-	/* Unlock font-surface */
-	SDL_UnlockSurface(gfxPrimitivesFont[(unsigned char) c]);
+    if ((dst->clip_rect.w==0) || (dst->clip_rect.h==0)) {
+     return(0);
     }
 
-    /*
-     * Draw bitmap onto destination surface 
-     */
-    if (dirtyDst == dst)
-	dirtyRects.push_back(drect);
-    result = SDL_BlitSurface(gfxPrimitivesFont[(unsigned char) c], &srect, dst, &drect);
+    atlas = glyphAtlas(color);
+    if (atlas == NULL)
+	return (-1);
 
-    return (result);
+    return (blitGlyph(dst, atlas, x, y, (unsigned char) c));
 }
 
 int characterRGBA(SDL_Surface * dst, Sint16 x, Sint16 y, char c, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
@@ -4628,9 +4791,18 @@ int stringColor(SDL_Surface * dst, Sint16 x, Sint16 y, const char *c, Uint32 col
     int result = 0;
     int curx = x;
     const char *curchar = c;
+    GlyphAtlas *atlas;
+
+    if ((dst->clip_rect.w==0) || (dst->clip_rect.h==0)) {
+     return(0);
+    }
+
+    atlas = glyphAtlas(color);
+    if (atlas == NULL)
+	return (-1);
  
     while (*curchar) {
-	result |= characterColor(dst, curx, y, *curchar, color);
+	result |= blitGlyph(dst, atlas, curx, y, (unsigned char) *curchar);
 	curx += charWidth;
 	curchar++;
     }
@@ -4638,6 +4810,54 @@ int stringColor(SDL_Surface * dst, Sint16 x, Sint16 y, const char *c, Uint32 col
     return (result);
 }
 
+SDL_Surface *stringSurface(const char *c, Uint32 color)
+{
+    const int len = strlen(c);
+    SDL_Surface *surface;
+    GlyphAtlas *atlas;
+    Uint8 *src, *dst;
+    int i, iy;
+
+    atlas = glyphAtlas(color);
+    if (atlas == NULL)
+	return (NULL);
+
+    surface = SDL_CreateRGBSurface(SDL_SWSURFACE | SDL_SRCALPHA,
+	    len > 0 ? len*charWidth : 1, charHeight, 32,
+	    0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF);
+    if (surface == NULL)
+	return (NULL);
+    SDL_SetAlpha(surface, SDL_SRCALPHA, 255);
+
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) != 0) {
+	SDL_FreeSurface(surface);
+	return (NULL);
+    }
+
+    /*
+     * Copy each glyph's rows from the atlas
+     */
+    for (i = 0; i < len; i++) {
+	const unsigned char ch = c[i];
+	if (needGlyph(atlas, ch) != 0)
+	    continue;
+	src = (Uint8 *) atlas->surface->pixels +
+	    (ch / 16) * charHeight * atlas->surface->pitch +
+	    (ch % 16) * charWidth * 4;
+	dst = (Uint8 *) surface->pixels + i * charWidth * 4;
+	for (iy = 0; iy < charHeight; iy++) {
+	    memcpy(dst, src, charWidth * 4);
+	    src += atlas->surface->pitch;
+	    dst += surface->pitch;
+	}
+    }
+
+    if (SDL_MUSTLOCK(surface))
+	SDL_UnlockSurface(surface);
+
+    return (surface);
+}
+
 int stringRGBA(SDL_Surface * dst, Sint16 x, Sint16 y, const char *c, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
 {
     /*
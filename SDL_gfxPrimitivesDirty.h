@@ -52,6 +52,17 @@ extern double antialiasGamma;
 
     DLLINTERFACE void setDirty(SDL_Surface* dst, SDL_Surface* background=NULL);
     DLLINTERFACE int blankDirty();
+/* Screen area restored by the last blankDirty: a list of rectangles, being
+ * runs of dirty 16x16 tiles, and their total area in pixels */
+    DLLINTERFACE int getRestoredRects(const SDL_Rect** rects);
+    DLLINTERFACE long getRestoredArea();
+/* Screen area changed since the last blankDirty: the tiles dirtied since,
+ * together with those it restored; after setDirty, the whole surface.
+ * Returns the number of rectangles, and sets *area to their total area */
+    DLLINTERFACE int getChangedRects(SDL_Rect** rects, long* area);
+/* SDL_BlitSurface, marking the destination rectangle dirty */
+    DLLINTERFACE int blitDirty(SDL_Surface* src, SDL_Rect* srcrect,
+	    SDL_Surface* dst, SDL_Rect* dstrect);
 
 /* Note: all ___Color routines expect the color to be in format 0xRRGGBBAA */
 
@@ -208,8 +219,14 @@ extern double antialiasGamma;
     DLLINTERFACE int characterRGBA(SDL_Surface * dst, Sint16 x, Sint16 y, char c, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
     DLLINTERFACE int stringColor(SDL_Surface * dst, Sint16 x, Sint16 y, const char *c, Uint32 color);
     DLLINTERFACE int stringRGBA(SDL_Surface * dst, Sint16 x, Sint16 y, const char *c, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+    /* a new surface with the string drawn in the current font, for blitting
+       where stringColor would draw it; NULL on failure */
+    DLLINTERFACE SDL_Surface *stringSurface(const char *c, Uint32 color);
 
     DLLINTERFACE void gfxPrimitivesSetFont(const void *fontdata, int cw, int ch);
+    /* glyphs drawn so far, as 'hits' from the glyph cache and 'misses'
+       which had first to be rendered */
+    DLLINTERFACE void gfxPrimitivesGlyphStats(unsigned long *hits, unsigned long *misses);
 
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
@@ -74,7 +74,11 @@ static struct _Mix_Channel {
 	Uint32 ticks_fade;
 	effect_info *effects;
 	int stretch;
-	int stretch_dj;
+	/* stretch_pos: position within the current sample frame, 16.16 */
+	Uint32 stretch_pos;
+	/* stretch_buf: room for one callback's worth of stretched samples,
+	   allocated with the channel so that mixing needn't allocate */
+	Uint8 *stretch_buf;
 } *mix_channel = NULL;
 
 static effect_info *posteffects = NULL;
@@ -130,6 +134,19 @@ static void _Mix_channel_done_playing(int channel)
 }
 
 
+/* apply the effects of a channel to a buffer they may modify */
+static void Mix_DoEffectsInPlace(int chan, void *buf, int len)
+{
+	effect_info *e = ((chan == MIX_CHANNEL_POST) ?
+			posteffects : mix_channel[chan].effects);
+
+	for (; e != NULL; e = e->next) {
+		if (e->callback != NULL) {
+			e->callback(chan, buf, len, e->udata);
+		}
+	}
+}
+
 static void *Mix_DoEffects(int chan, void *snd, int len)
 {
 	int posteffect = (chan == MIX_CHANNEL_POST);
@@ -146,17 +163,81 @@ static void *Mix_DoEffects(int chan, void *snd, int len)
 		    memcpy(buf, snd, len);
 		}
 
-		for (; e != NULL; e = e->next) {
-			if (e->callback != NULL) {
-				e->callback(chan, buf, len, e->udata);
-			}
-		}
+		Mix_DoEffectsInPlace(chan, buf, len);
 	}
 
 	/* be sure to free() the return value if != snd ... */
 	return(buf);
 }
 
+/* Resample up to 'len' bytes of a channel's sound into its stretch_buf,
+   playing it at 1000/stretch of its speed, and advance the channel past
+   the samples used. 'bytes' is the size of a sample frame. Returns the
+   number of bytes written.
+
+   The position is kept in 16.16 fixed point, in frames. Signed 16-bit
+   audio is interpolated linearly between frames; other formats take the
+   nearest frame before. */
+static int stretch_channel(int which, int bytes, int len)
+{
+	struct _Mix_Channel *channel = &mix_channel[which];
+	const Uint32 step = (((Uint32)1000 << 16) + channel->stretch/2) /
+		channel->stretch;
+	const int frames_in = channel->playing / bytes;
+	Uint32 pos = channel->stretch_pos;
+	int frames_out, f;
+
+	if (frames_in == 0) {
+		channel->playing = 0;
+		return 0;
+	}
+
+	/* as many frames as there are before running out of input, or room
+	   for */
+	frames_out = (int)((((Uint64)frames_in << 16) - pos + step - 1) / step);
+	if (frames_out > len / bytes) {
+		frames_out = len / bytes;
+	}
+
+	if (step == (1 << 16) && pos == 0) {
+		memcpy(channel->stretch_buf, channel->samples, frames_out*bytes);
+		pos = (Uint32)frames_out << 16;
+	} else if (mixer.format == AUDIO_S16SYS) {
+		const Sint16 *in = (const Sint16 *)channel->samples;
+		Sint16 *out = (Sint16 *)channel->stretch_buf;
+		const int samples = bytes / 2;
+		int k;
+		for (f = 0; f < frames_out; f++, pos += step) {
+			const int src = pos >> 16;
+			/* 15 bits of fraction, so that the product fits */
+			const Sint32 frac = (pos & 0xffff) >> 1;
+			const Sint16 *a = in + src*samples;
+			const Sint16 *b = (src+1 < frames_in) ? a + samples : a;
+			for (k = 0; k < samples; k++) {
+				*out++ = (Sint16)(a[k] + (((b[k] - a[k]) * frac) >> 15));
+			}
+		}
+	} else {
+		Uint8 *out = channel->stretch_buf;
+		for (f = 0; f < frames_out; f++, pos += step) {
+			memcpy(out, channel->samples + (pos >> 16)*bytes, bytes);
+			out += bytes;
+		}
+	}
+
+	/* keep the fraction; the whole frames passed are used up */
+	{
+		int used = (pos >> 16) * bytes;
+		if (used > channel->playing) {
+			used = channel->playing;
+		}
+		channel->samples += used;
+		channel->playing -= used;
+		channel->stretch_pos = pos & 0xffff;
+	}
+
+	return frames_out*bytes;
+}
 
 /* Mixing function */
 static void mix_channels(void *udata, Uint8 *stream, int len)
@@ -215,50 +296,20 @@ static void mix_channels(void *udata, Uint8 *stream, int len)
 				while (mix_channel[i].playing > 0 && index < len) {
 					remaining = len - index;
 
-					mixable = mix_channel[i].playing * mix_channel[i].stretch/1000;
-					mixable -= mixable%bytes;
-					if ( mixable > remaining ) {
-						mixable = remaining;
+					mixable = 0;
+					if (mix_channel[i].stretch_buf != NULL) {
+					    mixable = stretch_channel(i, bytes, remaining);
+					    Mix_DoEffectsInPlace(i,
+						    mix_channel[i].stretch_buf, mixable);
+					    SDL_MixAudio(stream+index,
+						    mix_channel[i].stretch_buf, mixable, volume);
+					} else {
+					    mix_channel[i].playing = 0;
 					}
-
-					Uint8* stretched = (Uint8*)malloc(mixable);
-
-					int used = ((long)mixable*1000 +
-						mix_channel[i].stretch_dj)/mix_channel[i].stretch;
-					used -= used%bytes;
-					if (used == 0)
-					    used = bytes;
-					if (used > mix_channel[i].playing)
-					    used = mix_channel[i].playing;
-
-					if (stretched != NULL)
-					{
-					    int j, k, targ;
-					    for (j=0; j < mixable; j+=bytes)
-					    {
-						targ = ((long)j*1000 +
-							mix_channel[i].stretch_dj)/mix_channel[i].stretch;
-						targ -= targ%bytes;
-						if (targ >= used)
-						    targ = used-bytes;
-						for (k=0; k < bytes; k++)
-						    stretched[j+k] = mix_channel[i].samples[targ+k];
-					    }
-					    mix_channel[i].stretch_dj =
-						(mix_channel[i].stretch_dj +
-						 (long)mixable*1000)%(mix_channel[i].stretch*bytes);
-
-					    mix_input = Mix_DoEffects(i, stretched, mixable);
-					    SDL_MixAudio(stream+index,mix_input,mixable,volume);
-
-					    if (mix_input != stretched)
-						free(mix_input);
-
-					    free(stretched);
+					if (mixable == 0 && mix_channel[i].playing) {
+					    /* less than a frame of room left */
+					    break;
 					}
-
-					mix_channel[i].samples += used;
-					mix_channel[i].playing -= used;
 					index += mixable;
 
 					/* rcg06072001 Alert app if channel is done playing. */
@@ -368,6 +419,9 @@ int Mix_OpenAudio(int frequency, Uint16 format, int nchannels, int chunksize)
 		mix_channel[i].expire = 0;
 		mix_channel[i].effects = NULL;
 		mix_channel[i].paused = 0;
+		mix_channel[i].stretch = 1000;
+		mix_channel[i].stretch_pos = 0;
+		mix_channel[i].stretch_buf = (Uint8 *) malloc(mixer.size);
 	}
 	Mix_VolumeMusic(SDL_MIX_MAXVOLUME);
 
@@ -396,6 +450,12 @@ int Mix_AllocateChannels(int numchans)
 		}
 	}
 	SDL_LockAudio();
+	{
+		int i;
+		for(i=numchans; i < num_channels; i++) {
+			free(mix_channel[i].stretch_buf);
+		}
+	}
 	mix_channel = (struct _Mix_Channel *) realloc(mix_channel, numchans * sizeof(struct _Mix_Channel));
 	if ( numchans > num_channels ) {
 		/* Initialize the new channels */
@@ -411,6 +471,9 @@ int Mix_AllocateChannels(int numchans)
 			mix_channel[i].expire = 0;
 			mix_channel[i].effects = NULL;
 			mix_channel[i].paused = 0;
+			mix_channel[i].stretch = 1000;
+			mix_channel[i].stretch_pos = 0;
+			mix_channel[i].stretch_buf = (Uint8 *) malloc(mixer.size);
 		}
 	}
 	num_channels = numchans;
@@ -764,7 +827,7 @@ int Mix_PlayChannelTimed(int which, Mix_Chunk *chunk, int loops, int ticks)
 			mix_channel[which].looping = loops;
 			mix_channel[which].chunk = chunk;
 			mix_channel[which].stretch = 1000;
-			mix_channel[which].stretch_dj = 0;
+			mix_channel[which].stretch_pos = 0;
 			mix_channel[which].paused = 0;
 			mix_channel[which].fading = MIX_NO_FADING;
 			mix_channel[which].start_time = sdl_ticks;
@@ -836,7 +899,7 @@ int Mix_FadeInChannelTimed(int which, Mix_Chunk *chunk, int loops, int ms, int t
 			mix_channel[which].looping = loops;
 			mix_channel[which].chunk = chunk;
 			mix_channel[which].stretch = 1000;
-			mix_channel[which].stretch_dj = 0;
+			mix_channel[which].stretch_pos = 0;
 			mix_channel[which].paused = 0;
 			mix_channel[which].fading = MIX_FADING_IN;
 			mix_channel[which].fade_volume = mix_channel[which].volume;
@@ -1042,6 +1105,9 @@ void Mix_CloseAudio(void)
 			Mix_HaltChannel(-1);
 			_Mix_DeinitEffects();
 			SDL_CloseAudio();
+			for (i = 0; i < num_channels; i++) {
+				free(mix_channel[i].stretch_buf);
+			}
 			free(mix_channel);
 			mix_channel = NULL;
 		}
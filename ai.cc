@@ -23,7 +23,7 @@
 #include "coords.h"
 #include "node.h"
 #include "gfx.h"
-#include "settings.h"
+#include "geom.h"
 
 /* AI
  *
@@ -47,22 +47,22 @@
 HPInvader* AI::closestEnemy()
 {
     HPInvader* closest = NULL;
-    float closestDist = -1;
+    float closestDistsq = -1;
 
-    for (std::vector<Invader*>::iterator it = gameState->invaders.begin();
-	    it != gameState->invaders.end();
-	    it++)
+    const InvaderStore& invaders = gameState->invaders;
+    static const Uint8 shootable =
+	InvaderStore::IF_EVIL | InvaderStore::IF_HITSSHOTS;
+    for (unsigned int i = 0; i < invaders.size(); i++)
     {
-	HPInvader* inv = dynamic_cast<HPInvader*>(*it);
-	if (inv == NULL)
+	HPInvader* inv = invaders.hpInvader[i];
+	if (inv == NULL || (invaders.flags[i] & shootable) != shootable)
 	    continue;
 
-	float d = dist(inv->cpos() - ARENA_CENTRE);
-	if ( inv->aiData.seen && inv->evil() && 
-		inv->hitsShots() && inv->armour < 3 &&
-		(closest == NULL || d < closestDist) )
+	const float dsq = (invaders.pos[i] - ARENA_CENTRE).lengthsq();
+	if ( inv->aiData.seen && inv->armour < 3 &&
+		(closest == NULL || dsq < closestDistsq) )
 	{
-	    closestDist = d;
+	    closestDistsq = dsq;
 	    closest = inv;
 	}
     }
@@ -70,19 +70,19 @@ HPInvader* AI::closestEnemy()
     return closest;
 }
 
+// AI::updateSeen: mark the invaders within the player's sight, which is the
+// disc that the zoomed view shows - whatever the screen, it reaches from the
+// view centre to the arena's edge
 void AI::updateSeen()
 {
     const RelPolarCoord d(gameState->you.aim.angle, gameState->zoomdist);
+    const CartCoord sightCentre = ARENA_CENTRE + d;
+    const float sightRad = (float)ARENA_RAD - gameState->zoomdist;
 
-    const View zoomView(ARENA_CENTRE + d,
-	    (float)screenGeom.rad/((float)ARENA_RAD-gameState->zoomdist),
-	    settings.rotatingView ? -d.angle : 0);
-
-    for (std::vector<Invader*>::iterator it = gameState->invaders.begin();
-	    it != gameState->invaders.end();
-	    it++)
-	if (zoomView.inView((*it)->cpos()))
-	    (*it)->aiData.seen=true;
+    InvaderStore& invaders = gameState->invaders;
+    for (unsigned int i = 0; i < invaders.size(); i++)
+	if ((invaders.pos[i] - sightCentre).lengthsq() <= sightRad*sightRad)
+	    invaders[i]->aiData.seen=true;
 }
 
 // AI::predictPos: return predicted position of 'inv' in 'time' ms
@@ -155,7 +155,7 @@ void BasicAI::update(int time)
 	{
 	    // consider shooting a pod
 	    if ( gameState->targettedNode != NULL &&
-		    gameState->targettedNode->status != NODEST_YOU &&
+		    gameState->targettedNode->status() != NODEST_YOU &&
 		    (gameState->you.shootHeat <
 		     gameState->you.shootMaxHeat - gameState->shotHeat(3)) )
 	    {
@@ -182,7 +182,7 @@ void BasicAI::update(int time)
 		if (dangle > 2)
 		    // normalise to [0,2]
 		    dangle = -dangle;
-		if (it->status == NODEST_YOU && it->primed >= 1
+		if (it->status() == NODEST_YOU && it->primed >= 1
 			&& ( node == NULL || dangle < minangle ))
 		{
 		    node = &*it;
@@ -226,7 +226,7 @@ void BasicAI::update(int time)
 	{
 	    targAimDist = std::min(AIM_MAX*2/3, aimPerDist*ppos.dist);
 	    const float turnTime = fabs(angleDiff(aim.angle, ppos.angle)) /
-		(0.015*settings.turnRateFactor*aimAccuracy);
+		(0.015*gameState->turnRateFactor*aimAccuracy);
 	    const float aimAtTarget = std::max(AIM_MIN, (float)(aim.dist-turnTime*.04));
 
 	    // aiming time required: almost exact, the +1 is just to avoid
@@ -278,7 +278,7 @@ void BasicAI::update(int time)
 	    keys |= K_LEFT;
 	else
 	    keys |= K_RIGHT;
-	if (! rani(300))
+	if (! rng.rani(300))
 	    newSeed();
     }
 }
@@ -298,9 +298,13 @@ int BasicAI::getShotWeight(int hp, int armour) const
 // behaviour has been completed (e.g. we fire off a shot)
 void BasicAI::newSeed()
 {
-    seed = rani(32767);
+    seed = rng.rani(32767);
 }
 
+AI::AI(GameState* gameState) :
+    gameState(gameState), rng(gameState->seed ^ 0x5bd1e995), keys(0)
+{}
+
 BasicAI::BasicAI(GameState* gameState) : AI(gameState)
 {
     newSeed();
@@ -3,6 +3,8 @@
 
 #include <SDL/SDL_stdinc.h>
 
+#include "random.h"
+
 class GameState;
 class Invader;
 class HPInvader;
@@ -13,6 +15,10 @@ class AI
     protected:
 	GameState* gameState;
 
+	// rng: the AI's own randomness, so that the game's is the same whether
+	// or not an AI is playing - as when an AI game is replayed
+	Random rng;
+
 	// Some utility functions for dealing with the state (which has
 	// befriended us)
 	HPInvader* closestEnemy();
@@ -32,7 +38,7 @@ class AI
 
 	virtual void update(int time) =0;
 
-	AI(GameState* gameState) : gameState(gameState), keys(0) {}
+	AI(GameState* gameState);
 
 	virtual ~AI() {}
 };
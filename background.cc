@@ -27,102 +27,428 @@ using namespace std;
 #include <SDL/SDL.h>
 #include <SDL_gfxPrimitivesDirty.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 SDL_Surface* background = NULL;
 
-void setBackground(SDL_Surface* screen)
+Uint32 randomStarColour(Random& rng, bool interesting=false);
+
+// putRGBRow: write row 'y' of 'surface', which must be locked, from 'rgb',
+// which holds three bytes for each pixel of the row
+static void putRGBRow(SDL_Surface* surface, int y, const Uint8* rgb)
 {
-    if (background)
-	SDL_FreeSurface(background);
-    if (settings.bgType == BG_NONE)
-	background = NULL;
-    else
-	background = SDL_CreateRGBSurface(SDL_SWSURFACE, screen->w, screen->h,
-		screen->format->BitsPerPixel, 0,0,0,0);
-    drawBackground(screen);
-}
+    const SDL_PixelFormat* f = surface->format;
+    Uint8* row = (Uint8*)surface->pixels + y*surface->pitch;
 
-Uint32 randomStarColour(bool interesting=false);
+    switch (f->BytesPerPixel)
+    {
+	case 4:
+	    for (int x=0; x < surface->w; x++, rgb += 3)
+		((Uint32*)row)[x] =
+		    (rgb[0] >> f->Rloss) << f->Rshift |
+		    (rgb[1] >> f->Gloss) << f->Gshift |
+		    (rgb[2] >> f->Bloss) << f->Bshift;
+	    break;
+	case 3:
+	    for (int x=0; x < surface->w; x++, rgb += 3)
+	    {
+		const Uint32 pixel =
+		    (rgb[0] >> f->Rloss) << f->Rshift |
+		    (rgb[1] >> f->Gloss) << f->Gshift |
+		    (rgb[2] >> f->Bloss) << f->Bshift;
+		Uint8* p = row + 3*x;
+		if (SDL_BYTEORDER == SDL_BIG_ENDIAN)
+		{
+		    p[0] = pixel >> 16;
+		    p[1] = pixel >> 8;
+		    p[2] = pixel;
+		}
+		else
+		{
+		    p[0] = pixel;
+		    p[1] = pixel >> 8;
+		    p[2] = pixel >> 16;
+		}
+	    }
+	    break;
+	case 2:
+	    for (int x=0; x < surface->w; x++, rgb += 3)
+		((Uint16*)row)[x] =
+		    (rgb[0] >> f->Rloss) << f->Rshift |
+		    (rgb[1] >> f->Gloss) << f->Gshift |
+		    (rgb[2] >> f->Bloss) << f->Bshift;
+	    break;
+	default:
+	    for (int x=0; x < surface->w; x++, rgb += 3)
+		row[x] = SDL_MapRGB(surface->format, rgb[0], rgb[1], rgb[2]);
+    }
+}
 
-void drawBackground(SDL_Surface* screen)
+// blendPixel: blend 'colour', RGBA as for pixelColor, onto pixel (x,y) of
+// 'surface', which must be locked. Unlike pixelColor, this touches no dirty
+// tracking state, so it is safe on the background thread.
+static void blendPixel(SDL_Surface* surface, int x, int y, Uint32 colour)
 {
-    if (!background)
+    const SDL_PixelFormat* f = surface->format;
+    Uint8* p = (Uint8*)surface->pixels + y*surface->pitch +
+	x*f->BytesPerPixel;
+
+    Uint32 pixel;
+    switch (f->BytesPerPixel)
     {
-	// background==NULL: use black background
-	SDL_FillRect(screen, NULL, 0);
-	return;
+	case 4: pixel = *(Uint32*)p; break;
+	case 3:
+		if (SDL_BYTEORDER == SDL_BIG_ENDIAN)
+		    pixel = p[0] << 16 | p[1] << 8 | p[2];
+		else
+		    pixel = p[0] | p[1] << 8 | p[2] << 16;
+		break;
+	case 2: pixel = *(Uint16*)p; break;
+	default: pixel = *p;
     }
 
-    SDL_FillRect(background, NULL, 0);
+    Uint8 dst[3];
+    SDL_GetRGB(pixel, surface->format, &dst[0], &dst[1], &dst[2]);
+    const int src[3] = { int(colour >> 24), int(colour >> 16 & 0xff),
+	int(colour >> 8 & 0xff) };
+    const int alpha = colour & 0xff;
+    const int loss[3] = { f->Rloss, f->Gloss, f->Bloss };
 
-    if (settings.bgType == BG_SOLAR)
+    // blend at the precision of the pixel format, as pixelColor does
+    Uint8 rgb[3];
+    for (int i=0; i<3; i++)
+    {
+	const int d = dst[i] >> loss[i];
+	const int s = src[i] >> loss[i];
+	rgb[i] = (d + ((s - d) * alpha >> 8)) << loss[i];
+    }
+
+    pixel = SDL_MapRGB(surface->format, rgb[0], rgb[1], rgb[2]);
+    switch (f->BytesPerPixel)
+    {
+	case 4: *(Uint32*)p = pixel; break;
+	case 3:
+		if (SDL_BYTEORDER == SDL_BIG_ENDIAN)
+		{
+		    p[0] = pixel >> 16;
+		    p[1] = pixel >> 8;
+		    p[2] = pixel;
+		}
+		else
+		{
+		    p[0] = pixel;
+		    p[1] = pixel >> 8;
+		    p[2] = pixel >> 16;
+		}
+		break;
+	case 2: *(Uint16*)p = pixel; break;
+	default: *p = pixel;
+    }
+}
+
+// drawBackground: draw a background of type 'bgType' on 'bg'. Called on the
+// background thread, so writes to 'bg' directly rather than with SDL_gfx,
+// whose dirty tracking is global.
+static void drawBackground(SDL_Surface* bg, BGType bgType, Random& rng)
+{
+    SDL_FillRect(bg, NULL, 0);
+
+    if (SDL_MUSTLOCK(bg))
+	SDL_LockSurface(bg);
+
+    if (bgType == BG_SOLAR)
     {
 	// Position a star offscreen (at least a screen's diagonal away from
 	// any onscreen point)
-	const double theta = ranf(2*PI);
-	const double dist = (ranf(2)+3)*sqrt(background->w*background->w +
-		background->h*background->h)/2;
-	const double cx = background->w/2 + dist*cos(theta);
-	const double cy = background->h/2 + dist*sin(theta);
+	const double theta = rng.ranf(2*PI);
+	const double dist = (rng.ranf(2)+3)*sqrt(
+		bg->w*bg->w +
+		bg->h*bg->h)/2;
+	const double cx = bg->w/2 + dist*cos(theta);
+	const double cy = bg->h/2 + dist*sin(theta);
 
-	const Uint32 colour = randomStarColour(true);
+	const Uint32 colour = randomStarColour(rng, true);
 	const int starColour[3] = {
 	    (colour & 0xff000000) >> 24,
 	    (colour & 0x00ff0000) >> 16,
 	    (colour & 0x0000ff00) >> 8 };
 
-	const Uint8 brightness = 0x70 + rani(0x20);
-	const double closestSqDist = background->w*background->w +
-	    background->h*background->h;
+	const Uint8 brightness = 0x70 + rng.rani(0x20);
+	const double closestSqDist = bg->w*bg->w +
+	    bg->h*bg->h;
 
 	// we want gaussian dither, but don't want to calculate a fresh
-	// gaussian for each pixel. So we sample, then use random samples for
-	// the dither.
-	const int bpp = background->format->BitsPerPixel;
-	static const int gaussianSampleSize = 200;
+	// gaussian for each pixel. So we sample, then index the samples with
+	// a cheap pseudo-random sequence, seeded afresh for each row.
+	const int bpp = bg->format->BitsPerPixel;
+	static const int gaussianSampleSize = 256;
 	int gaussianSample[gaussianSampleSize];
 	for (int i=0; i < gaussianSampleSize; i++)
-	    gaussianSample[i] = int(gaussian() * (
+	    gaussianSample[i] = int(rng.gaussian() * (
 			bpp == 32 ? 0x02 :
 			bpp == 24 ? 0x03 :
 			0x04));
 
-	for (int x=0; x < background->w; x++)
-	    for (int y=0; y < background->h; y++)
-	    {
-		// inverse square law for the intensity, with a random
-		// dithering effect to reduce ugly banding
-		const double sqDist = ((x-cx)*(x-cx) + (y-cy)*(y-cy));
-		const float intensity = closestSqDist / sqDist;
-
-		int c[3] = {
-		    int(starColour[0] * intensity) +
-			gaussianSample[rani(gaussianSampleSize)],
-		    int(starColour[1] * intensity) +
-			gaussianSample[rani(gaussianSampleSize)],
-		    int(starColour[2] * intensity) +
-			gaussianSample[rani(gaussianSampleSize)] };
+	// the glow is worked out a row at a time, in float
+	const int w = bg->w;
+	const float closest = closestSqDist;
+	vector<float> dxsq(w);
+	for (int x=0; x < w; x++)
+	    dxsq[x] = (x-cx)*(x-cx);
+	vector<float> intensity(w);
+	vector<Uint8> rgb(3*w);
+	const int loss[3] = { bg->format->Rloss,
+	    bg->format->Gloss, bg->format->Bloss };
 
+	for (int y=0; y < bg->h; y++)
+	{
+	    // inverse square law for the intensity, with a random
+	    // dithering effect to reduce ugly banding
+	    const float dysq = (y-cy)*(y-cy);
+	    int x = 0;
+#ifdef __SSE__
+	    const __m128 closest4 = _mm_set1_ps(closest);
+	    const __m128 dysq4 = _mm_set1_ps(dysq);
+	    for (; x+4 <= w; x += 4)
+		_mm_storeu_ps(&intensity[x], _mm_div_ps(closest4,
+			    _mm_add_ps(_mm_loadu_ps(&dxsq[x]), dysq4)));
+#endif
+	    for (; x < w; x++)
+		intensity[x] = closest / (dxsq[x] + dysq);
+
+	    Uint32 dither = rng.rani(0x7fffffff);
+	    for (int x=0; x < w; x++)
+	    {
+		dither = dither*1664525 + 1013904223;
 		for (int i=0; i<3; i++)
 		{
-		    if (c[i] > 0xff)
-			c[i] = 0xff;
-		    if (c[i] < 0)
-			c[i] = 0;
+		    int c = int(starColour[i] * intensity[x]) +
+			gaussianSample[(dither >> (8+8*i)) & 0xff];
+		    if (c > 0xff)
+			c = 0xff;
+		    if (c < 0)
+			c = 0;
+		    // as blended by pixelRGBA onto black, which works at
+		    // the precision of the pixel format
+		    rgb[3*x+i] = (c >> loss[i]) * brightness >> 8 << loss[i];
 		}
-		pixelRGBA(background, x, y, c[0], c[1], c[2], brightness);
 	    }
+
+	    putRGBRow(bg, y, &rgb[0]);
+	}
     }
 
-    if (settings.bgType == BG_STARS || settings.bgType == BG_SOLAR)
+    if (bgType == BG_STARS || bgType == BG_SOLAR)
 	for (int i=0;
-		i < (background->w * background->h / (400 + rani(800)));
+		i < (bg->w * bg->h / (400 + rng.rani(800)));
 		i++)
 	{
-	    pixelColor(background, rani(background->w), rani(background->h),
-		    randomStarColour() + 0x30 + rani(0x90));
+	    const int x = rng.rani(bg->w);
+	    const int y = rng.rani(bg->h);
+	    blendPixel(bg, x, y,
+		    randomStarColour(rng) + 0x30 + rng.rani(0x90));
 	}
 
+    if (SDL_MUSTLOCK(bg))
+	SDL_UnlockSurface(bg);
+}
+
+// BackgroundFormat: what a background is drawn for - the size and depth of
+// the screen, and the type of background
+struct BackgroundFormat
+{
+    int w, h, bpp;
+    BGType bgType;
+
+    bool operator==(const BackgroundFormat& f) const
+    {
+	return w == f.w && h == f.h && bpp == f.bpp && bgType == f.bgType;
+    }
+};
+
+// BackgroundJob: a background being drawn by a worker thread. Only 'done' is
+// shared while the thread runs.
+struct BackgroundJob
+{
+    BackgroundFormat format;
+    SDL_Surface* surface;
+    Random rng;
+    Uint32 startTicks;
+    bool done;
+};
+
+static BackgroundJob job;
+static bool jobRunning = false;
+static SDL_Thread* jobThread = NULL;
+static SDL_mutex* jobLock = NULL;
+
+// the format backgrounds are wanted in, and where their seeds come from
+static BackgroundFormat wantedFormat;
+static Random* seedRng = NULL;
+
+// waiting: a background has been requested which wasn't ready, so the next
+// one drawn should be swapped in straight away
+static bool waiting = false;
+
+// ready: backgrounds drawn ahead in wantedFormat, up to settings.bgCacheSize
+static vector<SDL_Surface*> ready;
+
+static Uint32 lastDrawTicks = 0;
+
+static int backgroundThread(void* data)
+{
+    BackgroundJob* j = (BackgroundJob*)data;
+    drawBackground(j->surface, j->format.bgType, j->rng);
+
+    SDL_LockMutex(jobLock);
+    j->done = true;
+    SDL_UnlockMutex(jobLock);
+    return 0;
+}
+
+// startJob: if no job is running, start drawing a background if one is
+// waited for or the cache isn't full
+static void startJob()
+{
+    if (jobRunning || wantedFormat.bgType == BG_NONE ||
+	    (!waiting && (int)ready.size() >= settings.bgCacheSize))
+	return;
+
+    job.surface = SDL_CreateRGBSurface(SDL_SWSURFACE,
+	    wantedFormat.w, wantedFormat.h, wantedFormat.bpp, 0,0,0,0);
+    if (!job.surface)
+	return;
+    job.format = wantedFormat;
+    job.rng.seed(seedRng->rani(0x7fffffff));
+    job.startTicks = SDL_GetTicks();
+    job.done = false;
+
+    if (!jobLock)
+	jobLock = SDL_CreateMutex();
+    jobRunning = true;
+    jobThread = SDL_CreateThread(backgroundThread, &job);
+    if (!jobThread)
+	// no thread to be had: draw it here and now, for the next update
+	backgroundThread(&job);
+}
+
+// useBackground: make 'bg' the background, and draw it to 'screen'
+static void useBackground(SDL_Surface* screen, SDL_Surface* bg)
+{
+    if (background)
+	SDL_FreeSurface(background);
+    background = bg;
     SDL_BlitSurface(background, NULL, screen, NULL);
+    // the whole screen has been redrawn
+    setDirty(screen, background);
+}
+
+void requestBackground(SDL_Surface* screen, Random& rng)
+{
+    BackgroundFormat format;
+    format.w = screen->w;
+    format.h = screen->h;
+    format.bpp = screen->format->BitsPerPixel;
+    format.bgType = settings.bgType;
+    seedRng = &rng;
+
+    if (!(format == wantedFormat))
+    {
+	// what has been drawn ahead is no use now
+	for (unsigned int i = 0; i < ready.size(); i++)
+	    SDL_FreeSurface(ready[i]);
+	ready.clear();
+	wantedFormat = format;
+    }
+
+    if (!ready.empty())
+    {
+	useBackground(screen, ready.back());
+	ready.pop_back();
+	waiting = false;
+	startJob();
+	return;
+    }
+
+    // keep the current background until the new one is ready, if it fits
+    if (background && (settings.bgType == BG_NONE ||
+		background->w != screen->w || background->h != screen->h ||
+		background->format->BitsPerPixel !=
+		screen->format->BitsPerPixel))
+    {
+	SDL_FreeSurface(background);
+	background = NULL;
+	setDirty(screen, NULL);
+    }
+    if (background)
+	SDL_BlitSurface(background, NULL, screen, NULL);
+    else
+	SDL_FillRect(screen, NULL, 0);
+
+    waiting = settings.bgType != BG_NONE;
+    startJob();
+}
+
+bool updateBackground(SDL_Surface* screen)
+{
+    if (!jobRunning)
+	return false;
+
+    SDL_LockMutex(jobLock);
+    const bool done = job.done;
+    SDL_UnlockMutex(jobLock);
+    if (!done)
+	return false;
+
+    if (jobThread)
+	SDL_WaitThread(jobThread, NULL);
+    jobThread = NULL;
+    jobRunning = false;
+    lastDrawTicks = SDL_GetTicks() - job.startTicks;
+
+    bool swapped = false;
+    if (!(job.format == wantedFormat))
+	// drawn for a screen we no longer have
+	SDL_FreeSurface(job.surface);
+    else if (waiting)
+    {
+	useBackground(screen, job.surface);
+	waiting = false;
+	swapped = true;
+    }
+    else
+	ready.push_back(job.surface);
+
+    startJob();
+    return swapped;
+}
+
+void finishBackground()
+{
+    if (jobRunning)
+    {
+	if (jobThread)
+	    SDL_WaitThread(jobThread, NULL);
+	jobThread = NULL;
+	jobRunning = false;
+	SDL_FreeSurface(job.surface);
+    }
+
+    for (unsigned int i = 0; i < ready.size(); i++)
+	SDL_FreeSurface(ready[i]);
+    ready.clear();
+
+    if (jobLock)
+	SDL_DestroyMutex(jobLock);
+    jobLock = NULL;
+}
+
+void backgroundStats(int* numReady, Uint32* drawTicks)
+{
+    *numReady = ready.size();
+    *drawTicks = lastDrawTicks;
 }
 
 Uint32 addColour(Uint32 base, int dr=0, int dg=0, int db=0, int da=0)
@@ -137,7 +463,7 @@ Uint32 addColour(Uint32 base, int dr=0, int dg=0, int db=0, int da=0)
     return (c[0] << 24) + (c[1] << 16) + (c[2] << 8) + c[3];
 }
 
-Uint32 randomStarColour(bool interesting)
+Uint32 randomStarColour(Random& rng, bool interesting)
 {
     // classColours based on data due to Mitchell Charity
     // (http://www.vendian.org/mncharity/dir3/starcolor/)
@@ -146,7 +472,7 @@ Uint32 randomStarColour(bool interesting)
 	0xe7e7ef00, 0xefe4db00, 0xefc49600, 0xefbf6800 };
 
     int starClass;
-    const float r = ranf();
+    const float r = rng.ranf();
     if (!interesting)
 	// roughly accurate frequency data based on that given in
 	// http://en.wikipedia.org/w/index.php?title=Stellar_classification&oldid=316377760
@@ -174,6 +500,7 @@ Uint32 randomStarColour(bool interesting)
 
     // Randomly tweak the colours a little
     return addColour(baseColour,
-	    int(gaussian()*0x0b), int(gaussian()*0x0b), int(gaussian()*0x0b));
+	    int(rng.gaussian()*0x0b), int(rng.gaussian()*0x0b),
+	    int(rng.gaussian()*0x0b));
 }
 
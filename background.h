@@ -3,12 +3,31 @@
 
 #include <SDL/SDL.h>
 
+#include "random.h"
+
 extern SDL_Surface* background;
 
-// setBackground: allocate and draw background
-void setBackground(SDL_Surface* screen);
+// requestBackground: change to a new background for 'screen', of the type in
+// settings. Backgrounds are drawn on a worker thread, which keeps up to
+// settings.bgCacheSize of them drawn ahead; if one is ready, it is used
+// straight away. Otherwise the old background is kept until the new one is
+// drawn if it still fits the screen, and the screen is black if not. Either
+// way, the background is drawn to 'screen'. Later backgrounds have their
+// seeds drawn from 'rng'.
+void requestBackground(SDL_Surface* screen, Random& rng);
+
+// updateBackground: call once a frame; if a requested background has been
+// drawn, make it the background, draw it to 'screen' and reset the dirty
+// tracking so that the whole screen is presented. Returns true if so.
+bool updateBackground(SDL_Surface* screen);
+
+// finishBackground: wait for the worker to finish any background it is
+// drawing, and free those drawn ahead. Must be called before SDL_Quit, so
+// that SDL isn't shut down under the worker.
+void finishBackground();
 
-// drawBackground: draw new background, keeping old screen format
-void drawBackground(SDL_Surface* screen);
+// backgroundStats: the number of backgrounds drawn ahead, and how long the
+// worker took to draw the last one
+void backgroundStats(int* numReady, Uint32* drawTicks);
 
 #endif /* INC_BACKGROUND_H */
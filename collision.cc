@@ -17,6 +17,8 @@
  */
 
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
 #include "collision.h"
 #include "coords.h"
@@ -149,3 +151,106 @@ bool CollisionPolygon::circleIntersects(CartCoord c, float rad) const
     // TODO properly
     return pointIn(c);
 }
+
+float CollisionPolygon::boundingRadius() const
+{
+    float maxsq = 0;
+    for (int i=0; i < numPoints; i++)
+	maxsq = std::max(maxsq, points[i].lengthsq());
+    return sqrt(maxsq);
+}
+
+CollisionGrid::CollisionGrid(int irings, int isectors) :
+    rings(irings), sectors(isectors), rad(1),
+    cells(irings*isectors), queryMark(0)
+{}
+
+void CollisionGrid::clear(CartCoord icentre, float irad)
+{
+    centre = icentre;
+    rad = irad;
+    for (std::vector< std::vector<int> >::iterator it = cells.begin();
+	    it != cells.end();
+	    it++)
+	it->clear();
+    marks.clear();
+    queryMark = 0;
+}
+
+void CollisionGrid::cellRange(CartCoord c, float r, int& ring0, int& ring1,
+	int& sector0, int& numSectors) const
+{
+    const RelCartCoord d = c - centre;
+    const float dist = sqrt(d.lengthsq());
+
+    ring0 = std::max(0, std::min(rings-1, int((dist-r)*rings/rad)));
+    ring1 = std::max(0, std::min(rings-1, int((dist+r)*rings/rad)));
+
+    if (dist <= r)
+    {
+	// circle contains the centre
+	sector0 = 0;
+	numSectors = sectors;
+	return;
+    }
+
+    const float theta = atan2(d.dy, d.dx) + PI;
+    const float halfWidth = asin(r/dist);
+    sector0 = int(floor((theta - halfWidth)*sectors/(2*PI)));
+    const int sector1 = int(floor((theta + halfWidth)*sectors/(2*PI)));
+    numSectors = std::min(sectors, sector1 - sector0 + 1);
+    sector0 = ((sector0 % sectors) + sectors) % sectors;
+}
+
+void CollisionGrid::insert(int index, CartCoord c, float r)
+{
+    int ring0, ring1, sector0, numSectors;
+    cellRange(c, r, ring0, ring1, sector0, numSectors);
+
+    for (int ring = ring0; ring <= ring1; ring++)
+	for (int i = 0; i < numSectors; i++)
+	    cells[ring*sectors + (sector0+i)%sectors].push_back(index);
+
+    if (index >= (int)marks.size())
+	marks.resize(index+1, 0);
+}
+
+void CollisionGrid::insert(int index, const CollisionObject& obj, float time)
+{
+    const RelCartCoord halfSweep = obj.velocity*(time/2);
+    insert(index, obj.startPos + halfSweep,
+	    obj.boundingRadius() + sqrt(halfSweep.lengthsq()));
+}
+
+void CollisionGrid::query(CartCoord c, float r, std::vector<int>& found)
+{
+    found.clear();
+    queryMark++;
+
+    int ring0, ring1, sector0, numSectors;
+    cellRange(c, r, ring0, ring1, sector0, numSectors);
+
+    for (int ring = ring0; ring <= ring1; ring++)
+	for (int i = 0; i < numSectors; i++)
+	{
+	    const std::vector<int>& cell =
+		cells[ring*sectors + (sector0+i)%sectors];
+	    for (std::vector<int>::const_iterator it = cell.begin();
+		    it != cell.end();
+		    it++)
+		if (marks[*it] != queryMark)
+		{
+		    marks[*it] = queryMark;
+		    found.push_back(*it);
+		}
+	}
+
+    std::sort(found.begin(), found.end());
+}
+
+void CollisionGrid::query(CartCoord p, RelCartCoord v, float time,
+	std::vector<int>& found)
+{
+    const RelCartCoord halfSweep = v*(time/2);
+    query(p + halfSweep, sqrt(halfSweep.lengthsq()), found);
+}
@@ -1,6 +1,8 @@
 #ifndef INC_COLLISION_H
 #define INC_COLLISION_H
 
+#include <vector>
+
 #include "coords.h"
 
 // pointHitsCircle: given a point starting at (x,y) moving with velocity
@@ -29,6 +31,10 @@ struct CollisionObject
 
     virtual bool circleIntersects(CartCoord c, float rad) const =0;
 
+    // boundingRadius: radius of a circle about startPos containing the
+    // object
+    virtual float boundingRadius() const =0;
+
     bool objectCollides(const CollisionCircle& other) const;
     bool objectCollides(const CollisionPolygon& other) const;
 
@@ -48,6 +54,8 @@ struct CollisionCircle : public CollisionObject
 
     bool circleIntersects(CartCoord c, float rad) const;
 
+    float boundingRadius() const { return radius; }
+
     float pointHits(CartCoord p, RelCartCoord v, float et=-1) const;
 };
 
@@ -62,6 +70,46 @@ struct CollisionPolygon : public CollisionObject
 
     bool circleIntersects(CartCoord c, float rad) const;
 
+    float boundingRadius() const;
+
     float pointHits(CartCoord p, RelCartCoord v, float et=-1) const;
 };
+
+// CollisionGrid: broad-phase index over a disc, cut into rings and sectors
+// about its centre. Objects are entered by index with a bounding circle;
+// queries return, in increasing order, the indices of those objects sharing
+// a cell with the query circle. Anything overlapping the query circle is
+// guaranteed to be returned; the caller does the exact tests.
+class CollisionGrid
+{
+    private:
+	int rings;
+	int sectors;
+	CartCoord centre;
+	float rad;
+
+	std::vector< std::vector<int> > cells;
+	std::vector<int> marks;
+	int queryMark;
+
+	// cellRange: rings [ring0,ring1] and numSectors sectors anticlockwise
+	// from sector0 (modulo 'sectors') cover the circle
+	void cellRange(CartCoord c, float r, int& ring0, int& ring1,
+		int& sector0, int& numSectors) const;
+
+    public:
+	void clear(CartCoord icentre, float irad);
+
+	void insert(int index, CartCoord c, float r);
+	// insert the region swept out by 'obj' over 'time' ms
+	void insert(int index, const CollisionObject& obj, float time);
+
+	void query(CartCoord c, float r, std::vector<int>& found);
+	// query the segment swept by a point at 'p' moving with velocity 'v'
+	// for 'time' ms
+	void query(CartCoord p, RelCartCoord v, float time,
+		std::vector<int>& found);
+
+	CollisionGrid(int irings=8, int isectors=32);
+};
 #endif /* INC_COLLISION_H */
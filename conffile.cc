@@ -63,7 +63,8 @@ double unobfuscatedRating(int obfuscated)
 
 Config::Config() :
     useAA(AA_YES), showGrid(true), zoomEnabled(true), rotatingView(true),
-    turnRateFactor(1.0), fps(30), showFPS(true), sound(true), volume(1.0),
+    partialUpdates(true), turnRateFactor(1.0), fps(30), showFPS(true),
+    sound(true), volume(1.0),
     soundFreq(44100),
     aaGamma(2.2),
     shouldUpdateRating(false), uuid(0),
@@ -128,6 +129,8 @@ void Config::read()
 		zoomEnabled = val;
 	    else if (sscanf(cstr, "rotatingView: %lf", &val) == 1)
 		rotatingView = val;
+	    else if (sscanf(cstr, "partialUpdates: %lf", &val) == 1)
+		partialUpdates = val;
 	    else if (sscanf(cstr, "turnRate: %lf", &val) == 1)
 		turnRateFactor = val;
 	    else if (sscanf(cstr, "showFPS: %lf", &val) == 1)
@@ -196,6 +199,7 @@ void Config::importSettings(const Settings& settings)
     showGrid = settings.showGrid;
     zoomEnabled = settings.zoomEnabled;
     rotatingView = settings.rotatingView;
+    partialUpdates = settings.partialUpdates;
     turnRateFactor = settings.turnRateFactor;
     fps = settings.fps;
     showFPS = settings.showFPS;
@@ -225,6 +229,7 @@ void Config::exportSettings(Settings& settings) const
     settings.showGrid = showGrid;
     settings.zoomEnabled = zoomEnabled;
     settings.rotatingView = rotatingView;
+    settings.partialUpdates = partialUpdates;
     settings.turnRateFactor = turnRateFactor;
     settings.fps = fps;
     settings.showFPS = showFPS;
@@ -292,7 +297,8 @@ void Config::write() const
 	    "freq: " << soundFreq << endl <<
 	    "antialiasGamma: " << aaGamma << endl << endl <<
 	    "mode: " << width << "x" << height << "x" << bpp << endl <<
-	    "fullscreen: " << fullscreen << endl << endl <<
+	    "fullscreen: " << fullscreen << endl <<
+	    "partialUpdates: " << partialUpdates << endl << endl <<
 	    "background: " << bgTypeStrings[bgType] << endl << endl <<
 	    "username: " << username << endl <<
 	    "uuid: " << hex << uuid << dec << endl <<
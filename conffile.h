@@ -21,6 +21,7 @@ class Config
 	bool showGrid;
 	bool zoomEnabled;
 	bool rotatingView;
+	bool partialUpdates;
 	float turnRateFactor;
 	int fps;
 	bool showFPS;
@@ -28,8 +28,10 @@ RelPolarCoord::RelPolarCoord(const RelCartCoord& c)
 
 RelCartCoord::RelCartCoord(const RelPolarCoord &rp)
 {
-    dx = -rp.dist*sin(rp.angle * (PI/2));
-    dy = rp.dist*cos(rp.angle * (PI/2));
+    float s, c;
+    fastSinCos(rp.angle, s, c);
+    dx = -rp.dist*s;
+    dy = rp.dist*c;
 }
 
 RelCartCoord RelCartCoord::rotated(float angle) const
@@ -37,9 +39,9 @@ RelCartCoord RelCartCoord::rotated(float angle) const
     if (angle == 0)
 	return *this;
 
-    RelPolarCoord p(*this);
-    p.angle += angle;
-    return p;
+    float s, c;
+    fastSinCos(angle, s, c);
+    return RelCartCoord(dx*c - dy*s, dx*s + dy*c);
 }
 
 float dist(RelPolarCoord c)
@@ -7,6 +7,34 @@
 
 struct RelCartCoord;
 
+// Coefficients for fastSinCos: the Taylor series of sin and cos, truncated
+// where the remaining terms are below float precision on [-PI/4, PI/4].
+static const float SINCOS_S3 = -1.0f/6, SINCOS_S5 = 1.0f/120,
+	     SINCOS_S7 = -1.0f/5040;
+static const float SINCOS_C2 = -1.0f/2, SINCOS_C4 = 1.0f/24,
+	     SINCOS_C6 = -1.0f/720, SINCOS_C8 = 1.0f/40320;
+
+// fastSinCos: sin and cos of 'a' in units of PI/2 (i.e. of a*PI/2), to
+// within a few float ulps of libm. 'a' is reduced to the nearest quarter
+// turn, and the quarter turn applied by swapping and negating, so any 'a'
+// within the range of an int will do.
+inline void fastSinCos(float a, float& s, float& c)
+{
+    // (floor by truncation, since floorf is a library call on some targets)
+    const float h = a + 0.5f;
+    const int q = int(h) - (h < 0);
+    const float x = (a - q) * float(PI/2);
+    const float x2 = x*x;
+    const float ps = x*(1 + x2*(SINCOS_S3 + x2*(SINCOS_S5 + x2*SINCOS_S7)));
+    const float pc = 1 + x2*(SINCOS_C2 + x2*(SINCOS_C4 +
+		x2*(SINCOS_C6 + x2*SINCOS_C8)));
+
+    const float s0 = (q & 1) ? pc : ps;
+    const float c0 = (q & 1) ? ps : pc;
+    s = (q & 2) ? -s0 : s0;
+    c = ((q+1) & 2) ? -c0 : c0;
+}
+
 // vertically upwards is 0, anticlockwise is positive; units are PI/2 radians.
 struct Angle
 {
@@ -38,17 +66,30 @@ struct Angle
 	normalise();
 	return *this;
     }
+    // normalise: bring angle into [0,4). Angles are almost always at most
+    // a turn out, so try that before resorting to fmod.
     void normalise()
     {
-	angle = fmod(angle,4);
-	while (angle < 0)
+	if (angle >= 4)
+	    angle -= 4;
+	else if (angle < 0)
 	    angle += 4;
+	if (angle < 0 || angle >= 4)
+	{
+	    angle = fmod(angle,4);
+	    if (angle < 0)
+		angle += 4;
+	    if (angle >= 4)
+		angle = 0;
+	}
     }
 
     float sinf() const
     {
 	// XXX: always use a.sinf() rather than sinf(a)!
-	return ::sinf(angle*PI/2);
+	float s, c;
+	fastSinCos(angle, s, c);
+	return s;
     }
 };
 
@@ -166,6 +207,11 @@ struct CartCoord
 	return (copy += rc);
     }
 
+    CartCoord operator - (const RelCartCoord &rc) const
+    {
+	return CartCoord(x-rc.dx, y-rc.dy);
+    }
+
     RelCartCoord operator - (const CartCoord &c) const
     {
 	RelCartCoord rc(x-c.x, y-c.y);
@@ -44,13 +44,3 @@ ScreenGeom::ScreenGeom(int iwidth, int iheight) :
 }
 
 ScreenGeom screenGeom;
-
-int ARENA_RAD = 220;
-
-float ZOOMDIST_MAX = (float)((ARENA_RAD/2));
-
-float AIM_MIN = 20.0;
-float ZOOM_MIN = 0.0;
-float AIM_MAX = ZOOMDIST_MAX;
-
-CartCoord ARENA_CENTRE(0,0);
@@ -24,14 +24,17 @@ struct ScreenGeom
 
 extern ScreenGeom screenGeom;
 
-extern int ARENA_RAD;
+// The arena is a disc of radius ARENA_RAD about ARENA_CENTRE, in the
+// coordinates of the game. It never changes, so these are constants which
+// the simulation's arithmetic can fold in; screenGeom is for drawing only.
+const int ARENA_RAD = 220;
 
-extern float AIM_MIN;
-extern float ZOOM_MIN;
-extern float AIM_MAX;
+const float AIM_MIN = 20.0;
+const float ZOOM_MIN = 0.0;
 
-extern float ZOOMDIST_MAX;
+const float ZOOMDIST_MAX = (float)((ARENA_RAD/2));
+const float AIM_MAX = ZOOMDIST_MAX;
 
-extern CartCoord ARENA_CENTRE;
+const CartCoord ARENA_CENTRE(0,0);
 
 #endif /* INC_GEOM_H */
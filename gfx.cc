@@ -17,6 +17,7 @@
  */
 
 #include <algorithm>
+#include <vector>
 #include <SDL/SDL.h>
 #include <SDL_gfxPrimitivesDirty.h>
 
@@ -25,6 +26,22 @@
 #include "geom.h"
 #include "settings.h"
 
+// scratchX, scratchY: storage for projected coordinates, reused between
+// draw calls; they grow to the largest size asked for and stay there.
+static std::vector<Sint16> scratchX;
+static std::vector<Sint16> scratchY;
+
+void scratchCoords(int n, Sint16*& xs, Sint16*& ys)
+{
+    if ((int)scratchX.size() < n)
+    {
+	scratchX.resize(n);
+	scratchY.resize(n);
+    }
+    xs = &scratchX[0];
+    ys = &scratchY[0];
+}
+
 View::View(CartCoord icentre, float izoom, float iangle) :
     centre(icentre), zoom(izoom), angle(iangle) {}
 
@@ -42,55 +59,70 @@ bool View::inView(const CartCoord &c, float in) const
     return ( (zoom*zoom)*(d.dx*d.dx+d.dy*d.dy) <= (screenGeom.rad-in)*(screenGeom.rad-in) );
 }
 
+// useAA: whether to antialias a primitive drawn to surface
+static bool useAA(const SDL_Surface* surface, bool noAA)
+{
+    if (drawList.isOpenOn(surface))
+	return drawList.useAA(noAA);
+    return ( (settings.useAA==AA_YES && !noAA) ||
+	    settings.useAA==AA_FORCE );
+}
+
 int Line::draw(SDL_Surface* surface, const View& view, View* boundView, bool noAA)
 {
+    if (boundView && !(boundView->inView(start) && boundView->inView(end)))
+	return 0;
+
     ScreenCoord s = view.coord(start);
     ScreenCoord e = view.coord(end);
-    const bool useAA = ( (settings.useAA==AA_YES && !noAA) ||
-	    settings.useAA==AA_FORCE );
-
-    Uint32 drawColour = colour;
+    const bool aa = useAA(surface, noAA);
 
-    if (!boundView || (boundView->inView(start) && boundView->inView(end)))
-	return ( useAA ? aalineColor : lineColor )
-	    (surface, s.x, s.y, e.x, e.y, drawColour);
-    else
+    if (drawList.isOpenOn(surface))
+    {
+	drawList.addLine(s, e, colour, aa);
 	return 0;
+    }
+
+    return ( aa ? aalineColor : lineColor )
+	(surface, s.x, s.y, e.x, e.y, colour);
 }
 
 int Circle::draw(SDL_Surface* surface, const View& view, View* boundView, bool noAA)
 {
-    bool useAA = ( (settings.useAA==AA_YES && !noAA) ||
-	    settings.useAA==AA_FORCE );
+    if (boundView && !boundView->inView(centre, r*boundView->zoom))
+	return 0;
+
+    bool aa = useAA(surface, noAA);
     ScreenCoord c = view.coord(centre);
     float screenRad = r*view.zoom;
 
     if (screenRad > 2*screenGeom.rad)
 	// our AA circle algorithm doesn't handle huge circles well
-	useAA = false;
+	aa = false;
 
-    if (!boundView || boundView->inView(centre, r*boundView->zoom))
-	return (filled ? filledCircleColor :
-		useAA ? aacircleColor : circleColor)
-	    (surface, c.x, c.y, int(screenRad), colour);
-    else
+    if (drawList.isOpenOn(surface))
+    {
+	drawList.addCircle(c, int(screenRad), colour, filled, aa);
 	return 0;
+    }
+
+    return (filled ? filledCircleColor :
+	    aa ? aacircleColor : circleColor)
+	(surface, c.x, c.y, int(screenRad), colour);
 }
 
 int Polygon::draw(SDL_Surface* surface, const View& view, View* boundView, bool noAA)
 {
-    const bool useAA = ( (settings.useAA==AA_YES && !noAA) ||
-	    settings.useAA==AA_FORCE );
-
     for (int i=0; i<n; i++)
     {
 	if (boundView && !boundView->inView(points[i]))
 	    return 0;
     }
 
-    Sint16 *sx = new Sint16[n];
-    Sint16 *sy = new Sint16[n];
-    int ret;
+    const bool aa = useAA(surface, noAA);
+
+    Sint16 *sx, *sy;
+    scratchCoords(n, sx, sy);
 
     for (int i=0; i<n; i++)
     {
@@ -99,22 +131,204 @@ int Polygon::draw(SDL_Surface* surface, const View& view, View* boundView, bool
 	sy[i] = s.y;
     }
 
-    ret = ( filled ? filledPolygonColor :
-	    useAA ? aapolygonColor : polygonColor )(
-		surface, sx, sy, n, colour);
+    if (drawList.isOpenOn(surface))
+    {
+	drawList.addPolygon(sx, sy, n, colour, filled, aa);
+	return 0;
+    }
 
-    delete[] sx;
-    delete[] sy;
-    return ret;
+    return ( filled ? filledPolygonColor :
+	    aa ? aapolygonColor : polygonColor )(
+		surface, sx, sy, n, colour);
 }
 
 int Pixel::draw(SDL_Surface* surface, const View& view, View* boundView, bool noAA)
 {
     if (boundView && !boundView->inView(point))
 	return 0;
-    else
+
+    ScreenCoord c = view.coord(point);
+
+    if (drawList.isOpenOn(surface))
     {
-	ScreenCoord c = view.coord(point);
-	return pixelColor(surface, c.x, c.y, colour);
+	drawList.addPixel(c, colour);
+	return 0;
     }
+
+    return pixelColor(surface, c.x, c.y, colour);
+}
+
+DrawList drawList;
+
+DrawList::DrawList() :
+    surface(NULL), layer(0), aaMode(AA_NO),
+    lastCommands(0), lastCulled(0), lastFlushTicks(0)
+{}
+
+void DrawList::open(SDL_Surface* isurface)
+{
+    surface = isurface;
+    layer = 0;
+    aaMode = settings.useAA;
+    commands.clear();
+    vx.clear();
+    vy.clear();
+}
+
+void DrawList::newLayer()
+{
+    // layers are held in a byte; past the last, everything shares it
+    if (layer < 255)
+	layer++;
+}
+
+bool DrawList::useAA(bool noAA) const
+{
+    return (aaMode==AA_YES && !noAA) || aaMode==AA_FORCE;
+}
+
+void DrawList::add(Uint8 type, Uint32 colour, Sint16 x1, Sint16 y1,
+	Sint16 x2, Sint16 y2, Sint16 minX, Sint16 minY, Sint16 maxX,
+	Sint16 maxY)
+{
+    Command c;
+    c.type = type;
+    c.layer = layer;
+    c.colour = colour;
+    c.x1 = x1; c.y1 = y1; c.x2 = x2; c.y2 = y2;
+    c.vertex = 0;
+    c.minX = minX; c.minY = minY; c.maxX = maxX; c.maxY = maxY;
+    commands.push_back(c);
+}
+
+void DrawList::addLine(ScreenCoord s, ScreenCoord e, Uint32 colour, bool aa)
+{
+    add(aa ? PT_AALINE : PT_LINE, colour, s.x, s.y, e.x, e.y,
+	    std::min(s.x, e.x), std::min(s.y, e.y),
+	    std::max(s.x, e.x), std::max(s.y, e.y));
+}
+
+void DrawList::addCircle(ScreenCoord c, int r, Uint32 colour, bool filled,
+	bool aa)
+{
+    add(filled ? PT_FILLEDCIRCLE : aa ? PT_AACIRCLE : PT_CIRCLE, colour,
+	    c.x, c.y, r, 0,
+	    c.x - r - 1, c.y - r - 1, c.x + r + 1, c.y + r + 1);
+}
+
+void DrawList::addPolygon(const Sint16* xs, const Sint16* ys, int n,
+	Uint32 colour, bool filled, bool aa)
+{
+    if (n <= 0)
+	return;
+    Sint16 minX = xs[0], minY = ys[0], maxX = xs[0], maxY = ys[0];
+    const int vertex = vx.size();
+    for (int i=0; i<n; i++)
+    {
+	minX = std::min(minX, xs[i]); maxX = std::max(maxX, xs[i]);
+	minY = std::min(minY, ys[i]); maxY = std::max(maxY, ys[i]);
+	vx.push_back(xs[i]);
+	vy.push_back(ys[i]);
+    }
+    add(filled ? PT_FILLEDPOLYGON : aa ? PT_AAPOLYGON : PT_POLYGON, colour,
+	    0, 0, n, 0, minX - 1, minY - 1, maxX + 1, maxY + 1);
+    commands.back().vertex = vertex;
+}
+
+void DrawList::addPixel(ScreenCoord p, Uint32 colour)
+{
+    add(PT_PIXEL, colour, p.x, p.y, 0, 0, p.x, p.y, p.x, p.y);
+}
+
+int DrawList::flush()
+{
+    if (!surface)
+	return 0;
+
+    const Uint32 startTicks = SDL_GetTicks();
+    const SDL_Rect& clip = surface->clip_rect;
+    const int numKeys = (layer+1)*PT_NUM;
+
+    // cull, and count commands per (layer, type) key
+    bucketStart.assign(numKeys+1, 0);
+    int culled = 0;
+    for (std::vector<Command>::iterator it = commands.begin();
+	    it != commands.end();
+	    it++)
+    {
+	if (it->maxX < clip.x || it->minX >= clip.x + clip.w ||
+		it->maxY < clip.y || it->minY >= clip.y + clip.h)
+	{
+	    it->type = PT_NUM;
+	    culled++;
+	    continue;
+	}
+	bucketStart[it->layer*PT_NUM + it->type + 1]++;
+    }
+
+    // counting sort, stable within each key
+    for (int k = 0; k < numKeys; k++)
+	bucketStart[k+1] += bucketStart[k];
+    order.resize(commands.size() - culled);
+    for (int i = 0; i < (int)commands.size(); i++)
+	if (commands[i].type != PT_NUM)
+	    order[bucketStart[commands[i].layer*PT_NUM +
+		commands[i].type]++] = i;
+
+    // the primitives lock the surface themselves, but locks nest, so
+    // holding it here means the real lock is taken only once
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0)
+    {
+	surface = NULL;
+	return -1;
+    }
+
+    for (std::vector<int>::const_iterator it = order.begin();
+	    it != order.end();
+	    it++)
+    {
+	const Command& c = commands[*it];
+	switch (c.type)
+	{
+	    case PT_FILLEDPOLYGON:
+		filledPolygonColor(surface, &vx[c.vertex], &vy[c.vertex],
+			c.x2, c.colour);
+		break;
+	    case PT_POLYGON:
+		polygonColor(surface, &vx[c.vertex], &vy[c.vertex], c.x2,
+			c.colour);
+		break;
+	    case PT_AAPOLYGON:
+		aapolygonColor(surface, &vx[c.vertex], &vy[c.vertex], c.x2,
+			c.colour);
+		break;
+	    case PT_FILLEDCIRCLE:
+		filledCircleColor(surface, c.x1, c.y1, c.x2, c.colour);
+		break;
+	    case PT_CIRCLE:
+		circleColor(surface, c.x1, c.y1, c.x2, c.colour);
+		break;
+	    case PT_AACIRCLE:
+		aacircleColor(surface, c.x1, c.y1, c.x2, c.colour);
+		break;
+	    case PT_LINE:
+		lineColor(surface, c.x1, c.y1, c.x2, c.y2, c.colour);
+		break;
+	    case PT_AALINE:
+		aalineColor(surface, c.x1, c.y1, c.x2, c.y2, c.colour);
+		break;
+	    case PT_PIXEL:
+		pixelColor(surface, c.x1, c.y1, c.colour);
+		break;
+	}
+    }
+
+    if (SDL_MUSTLOCK(surface))
+	SDL_UnlockSurface(surface);
+
+    lastCommands = commands.size();
+    lastCulled = culled;
+    lastFlushTicks = SDL_GetTicks() - startTicks;
+    surface = NULL;
+    return 0;
 }
@@ -1,6 +1,7 @@
 #ifndef INC_GFX_H
 #define INC_GFX_H
 
+#include <vector>
 #include <SDL/SDL.h>
 
 #include "coords.h"
@@ -47,6 +48,11 @@ struct Circle
 	bool noAA=false);
 };
 
+// scratchCoords: set xs and ys to point to arrays of at least n screen
+// coordinates, valid until the next call. Only allocates when n exceeds all
+// previous requests.
+void scratchCoords(int n, Sint16*& xs, Sint16*& ys);
+
 struct Polygon
 {
     CartCoord* points;
@@ -75,4 +81,98 @@ struct Pixel
 	bool noAA=false);
 };
 
+// DrawList: a retained list of primitives in screen coordinates. While a
+// DrawList is open on a surface, drawing a Line, Circle, Polygon or Pixel
+// to that surface records a command in the list rather than drawing it
+// immediately. flush() then culls the commands against the surface's clip
+// rectangle, sorts them, and draws them all under a single lock of the
+// surface.
+//
+// Commands are sorted by layer, then by primitive type - fills first, then
+// outlines, lines and pixels - and otherwise kept in the order they were
+// added. Callers start a new layer where later primitives must be drawn
+// over earlier ones regardless of type.
+class DrawList
+{
+    public:
+	enum PrimType
+	{
+	    PT_FILLEDPOLYGON,
+	    PT_FILLEDCIRCLE,
+	    PT_POLYGON,
+	    PT_AAPOLYGON,
+	    PT_CIRCLE,
+	    PT_AACIRCLE,
+	    PT_LINE,
+	    PT_AALINE,
+	    PT_PIXEL,
+	    PT_NUM
+	};
+
+	struct Command
+	{
+	    Uint8 type;
+	    Uint8 layer;
+	    Uint32 colour;
+	    // lines: endpoints; circles: centre and radius (x2); pixels:
+	    // (x1,y1); polygons: number of vertices (x2), the first of which
+	    // is at index 'vertex'
+	    Sint16 x1, y1, x2, y2;
+	    int vertex;
+	    // screen bounding box, for culling
+	    Sint16 minX, minY, maxX, maxY;
+	};
+
+    private:
+	SDL_Surface* surface;
+	int layer;
+	int aaMode;
+
+	std::vector<Command> commands;
+	std::vector<Sint16> vx;
+	std::vector<Sint16> vy;
+
+	// scratch for the sort, reused between flushes
+	std::vector<int> bucketStart;
+	std::vector<int> order;
+
+	void add(Uint8 type, Uint32 colour, Sint16 x1, Sint16 y1, Sint16 x2,
+		Sint16 y2, Sint16 minX, Sint16 minY, Sint16 maxX, Sint16 maxY);
+
+    public:
+	// statistics from the last flush
+	int lastCommands;
+	int lastCulled;
+	Uint32 lastFlushTicks;
+
+	// open: start recording draws to 'surface'. The AA setting is read
+	// once here, and applies to everything recorded.
+	void open(SDL_Surface* isurface);
+	bool isOpenOn(const SDL_Surface* s) const
+	{ return surface != NULL && surface == s; }
+
+	void newLayer();
+
+	// useAA: whether a primitive should be antialiased, given its noAA
+	// argument
+	bool useAA(bool noAA) const;
+
+	void addLine(ScreenCoord s, ScreenCoord e, Uint32 colour, bool aa);
+	void addCircle(ScreenCoord c, int r, Uint32 colour, bool filled,
+		bool aa);
+	// addPolygon: xs and ys may be scratchCoords
+	void addPolygon(const Sint16* xs, const Sint16* ys, int n,
+		Uint32 colour, bool filled, bool aa);
+	void addPixel(ScreenCoord p, Uint32 colour);
+
+	// flush: draw the recorded commands and close the list. Returns 0, or
+	// -1 if the surface couldn't be locked.
+	int flush();
+
+	DrawList();
+};
+
+// drawList: the list used by GameState::draw
+extern DrawList drawList;
+
 #endif /* INC_GFX_H */
@@ -0,0 +1,288 @@
+/*
+ * Kuklomenos
+ * Copyright (C) 2008-2009 Martin Bays <mbays@sdf.lonestar.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <SDL/SDL.h>
+#include <SDL_gfxPrimitivesDirty.h>
+
+#include "indicator.h"
+#include "geom.h"
+#include "coords.h"
+
+bool IndicatorState::sameLook(const IndicatorState& other) const
+{
+    // extraction and shield are continuous, so we quantise them finely
+    // enough that no pixel of the ring is affected by the rounding
+    return shootHeat == other.shootHeat &&
+	shootMaxHeat == other.shootMaxHeat &&
+	int(extracted*4) == int(other.extracted*4) &&
+	extractPreMutCutoff == other.extractPreMutCutoff &&
+	extractMax == other.extractMax &&
+	int(shield*1024) == int(other.shield*1024) &&
+	evilHasCyan == other.evilHasCyan &&
+	youHaveCyan == other.youHaveCyan;
+}
+
+// approxAtan2Frac: approximates atan2(y,x)*(6/PI)-1
+//  (being the linear function of atan2(y,x) which is 0 at PI/6 and 1 at PI/3)
+float approxAtan2Frac(int y, int x)
+{
+    static const int N = 10;
+    static const float left=0.5, right=2.0;
+    static float z0[N];
+    static float t0[N], t1[N];
+    static const float halfDist = (right-left)/(2*(N-1));
+    static bool preCalced=false;
+
+    if (!preCalced)
+    {
+	// calculate first two terms of the Taylor expansion around some
+	// values of z spaced uniformly along the interval
+	for (int i = 0; i < N; i++)
+	{
+	    z0[i] = left + (right-left)*i/(N-1);
+
+	    t0[i] = atan(z0[i])*(6.0/PI)-1;
+	    t1[i] = (1.0/(1+z0[i]*z0[i]))*(6.0/PI);
+	}
+	preCalced = true;
+    }
+
+    float z = float(y)/x;
+
+    // use the precalculated linear approximation around the closest z value
+    for (int i = 0; i < N; i++)
+	if ( i == N-1 || z < z0[i] + halfDist )
+	    return t0[i] + t1[i]*(z-z0[i]);
+
+    return 0; // won't happen
+
+    // cubic approximation to atan(z) around z=1:
+    // return PI/4 + (z-1)/2 - (z-1)*(z-1)/4 + (z-1)*(z-1)*(z-1)/12;
+}
+
+IndicatorRing::IndicatorRing() :
+    geomWidth(0), geomHeight(0), left(NULL), right(NULL), rendered(false)
+{}
+
+IndicatorRing::~IndicatorRing()
+{
+    freeSurfaces();
+}
+
+void IndicatorRing::freeSurfaces()
+{
+    if (left)
+	SDL_FreeSurface(left);
+    if (right)
+	SDL_FreeSurface(right);
+    left = right = NULL;
+}
+
+void IndicatorRing::setGeometry()
+{
+    pixels.clear();
+    freeSurfaces();
+    rendered = false;
+    geomWidth = screenGeom.width;
+    geomHeight = screenGeom.height;
+
+    int minX = screenGeom.width, maxX = 0;
+    int minY = screenGeom.height, maxY = 0;
+    for (int x = screenGeom.rad/2;
+	    x <= 866*screenGeom.rad/1000 + 15;
+	    x++)
+    {
+	const int xsq = x*x;
+	int rsq;
+	for (int y = int(sqrt(screenGeom.indicatorRsqLim1 - xsq));
+		(rsq = xsq + y*y) <= screenGeom.indicatorRsqLim4;
+		y++)
+	{
+	    if (rsq < screenGeom.indicatorRsqLim1)
+		continue;
+	    const float frac = approxAtan2Frac(y,x);
+	    if (frac < 0 || frac > 1)
+		continue;
+
+	    RingPixel p;
+	    p.x = x;
+	    p.y = y;
+	    p.frac = frac;
+	    if (rsq <= screenGeom.indicatorRsqLim2)
+	    {
+		p.band = RB_INNER;
+		// decay towards the edges, for prettiness
+		p.decay = std::min(255,
+			std::min(rsq - screenGeom.indicatorRsqLim1,
+			    screenGeom.indicatorRsqLim2 - rsq)/2);
+	    }
+	    else if (rsq < screenGeom.indicatorRsqLim3)
+	    {
+		p.band = RB_SHADE;
+		p.decay = 0xa0;
+	    }
+	    else
+	    {
+		p.band = RB_SHIELD;
+		p.decay = std::min(255,
+			std::min(rsq - screenGeom.indicatorRsqLim3,
+			    screenGeom.indicatorRsqLim4 - rsq)/2);
+	    }
+	    pixels.push_back(p);
+
+	    minX = std::min(minX, x); maxX = std::max(maxX, x);
+	    minY = std::min(minY, y); maxY = std::max(maxY, y);
+	}
+    }
+    if (pixels.empty())
+	return;
+
+    const int w = maxX - minX + 1;
+    const int h = maxY - minY + 1;
+    leftRect.x = screenGeom.centre.x - maxX;
+    rightRect.x = screenGeom.centre.x + minX;
+    leftRect.y = rightRect.y = screenGeom.centre.y - maxY;
+    leftRect.w = rightRect.w = w;
+    leftRect.h = rightRect.h = h;
+
+    // 32-bit RGBA, blended onto the screen when blitted
+    const Uint32 rmask = 0xff000000, gmask = 0x00ff0000,
+	  bmask = 0x0000ff00, amask = 0x000000ff;
+    left = SDL_CreateRGBSurface(SDL_SWSURFACE|SDL_SRCALPHA, w, h, 32,
+	    rmask, gmask, bmask, amask);
+    right = SDL_CreateRGBSurface(SDL_SWSURFACE|SDL_SRCALPHA, w, h, 32,
+	    rmask, gmask, bmask, amask);
+    if (!left || !right)
+	freeSurfaces();
+}
+
+// setPixel: set a pixel of a surface created by setGeometry, with colour in
+// the 0xRRGGBBAA form used by SDL_gfx
+static inline void setPixel(SDL_Surface* s, int x, int y, Uint32 colour)
+{
+    *((Uint32*)((Uint8*)s->pixels + y*s->pitch) + x) = colour;
+}
+
+void IndicatorRing::render(const IndicatorState& state)
+{
+    if (SDL_MUSTLOCK(left))
+	SDL_LockSurface(left);
+    if (SDL_MUSTLOCK(right))
+	SDL_LockSurface(right);
+
+    SDL_FillRect(left, NULL, 0);
+    SDL_FillRect(right, NULL, 0);
+
+    // position of the screen centre relative to each surface
+    const int lx0 = screenGeom.centre.x - leftRect.x;
+    const int rx0 = screenGeom.centre.x - rightRect.x;
+    const int y0 = screenGeom.centre.y - leftRect.y;
+
+    for (std::vector<RingPixel>::const_iterator it = pixels.begin();
+	    it != pixels.end();
+	    it++)
+    {
+	const float frac = it->frac;
+	const int decay = it->decay;
+	Uint32 colour;
+	int intensity;
+	switch (it->band)
+	{
+	    case RB_INNER:
+		// heat
+		intensity = 
+		    state.shootHeat > state.shootMaxHeat*frac ?
+		    55+int(200*frac) :
+		    (frac >= 0.98 ? int(5000*(frac-0.98)) : 0) + (
+			    35 );
+		colour = 0x01000000 * intensity + decay;
+		setPixel(left, lx0 - it->x, y0 - it->y, colour);
+
+		// extraction
+		if (state.extracted <= state.extractPreMutCutoff)
+		    intensity =
+			state.extracted > state.extractPreMutCutoff*frac ?
+			55+int(200*frac) :
+			(frac >= 0.98 ? int(5000*(frac-0.98)) : 0) + (
+				state.evilHasCyan ? 55 : 35 );
+		else
+		    intensity =
+			((state.extracted - state.extractPreMutCutoff) >
+			 (state.extractMax - state.extractPreMutCutoff)*frac) ?
+			85+int(170*frac) :
+			(frac >= 0.98 ? int(5000*(frac-0.98)) : 0) + (
+				state.evilHasCyan ? 85 : 60 );
+		colour = 0x00010100 * intensity + decay;
+		setPixel(right, rx0 + it->x, y0 - it->y, colour);
+		break;
+
+	    case RB_SHADE:
+		// shade between heat and shield indicators
+		setPixel(left, lx0 - it->x, y0 - it->y, decay);
+		break;
+
+	    case RB_SHIELD:
+		{
+		    // shield
+		    const int i = int(frac*4);
+		    const Uint32 baseColour =
+			(i == 0) ? 0x01000000 :
+			(i == 1) ? 0x01010000 :
+			(i == 2) ? 0x00010000 :
+			0x00010100;
+
+		    intensity =
+			(state.shield > frac*4) ?
+			55+(int(4*200*frac))%200 :
+			state.youHaveCyan ? 55 :
+			35;
+
+		    colour = baseColour * intensity + decay;
+		    setPixel(left, lx0 - it->x, y0 - it->y, colour);
+		}
+		break;
+	}
+    }
+
+    if (SDL_MUSTLOCK(left))
+	SDL_UnlockSurface(left);
+    if (SDL_MUSTLOCK(right))
+	SDL_UnlockSurface(right);
+
+    rendered = true;
+    renderedState = state;
+}
+
+void IndicatorRing::draw(SDL_Surface* surface, const IndicatorState& state)
+{
+    if (geomWidth != screenGeom.width || geomHeight != screenGeom.height)
+	setGeometry();
+    if (!left || !right)
+	return;
+
+    if (!rendered || !state.sameLook(renderedState))
+	render(state);
+
+    SDL_Rect r = leftRect;
+    blitDirty(left, NULL, surface, &r);
+    r = rightRect;
+    blitDirty(right, NULL, surface, &r);
+}
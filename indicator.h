@@ -0,0 +1,77 @@
+#ifndef INC_INDICATOR_H
+#define INC_INDICATOR_H
+
+#include <vector>
+#include <SDL/SDL.h>
+
+// IndicatorState: what the indicator ring shows
+struct IndicatorState
+{
+    int shootHeat;
+    int shootMaxHeat;
+    double extracted;
+    int extractPreMutCutoff;
+    int extractMax;
+    float shield;
+    bool evilHasCyan;
+    bool youHaveCyan;
+
+    // sameLook: whether the ring drawn for this state would look the same
+    // as for 'other', up to differences smaller than a pixel of the ring
+    bool sameLook(const IndicatorState& other) const;
+};
+
+// IndicatorRing: the heat, extraction and shield indicators around the top
+// of the arena. The positions of the ring's pixels are worked out once per
+// screen geometry, and the ring is rendered into cached surfaces which are
+// re-rendered only when the state shown changes, and blitted each frame.
+class IndicatorRing
+{
+    private:
+	enum Band
+	{
+	    // heat on the left, extraction on the right
+	    RB_INNER,
+	    // dark gap between the heat and shield indicators
+	    RB_SHADE,
+	    RB_SHIELD
+	};
+
+	// RingPixel: a pixel at (centre.x - x, centre.y - y), or for the
+	// extraction indicator (centre.x + x, centre.y - y)
+	struct RingPixel
+	{
+	    Sint16 x, y;
+	    float frac;
+	    Uint8 band;
+	    Uint8 decay;
+	};
+
+	std::vector<RingPixel> pixels;
+
+	// geometry the table was computed for
+	int geomWidth, geomHeight;
+
+	// left and right halves of the ring, and where they go on the screen
+	SDL_Surface* left;
+	SDL_Surface* right;
+	SDL_Rect leftRect, rightRect;
+
+	bool rendered;
+	IndicatorState renderedState;
+
+	void setGeometry();
+	void render(const IndicatorState& state);
+	void freeSurfaces();
+
+	IndicatorRing(const IndicatorRing&);
+	IndicatorRing& operator=(const IndicatorRing&);
+
+    public:
+	void draw(SDL_Surface* surface, const IndicatorState& state);
+
+	IndicatorRing();
+	~IndicatorRing();
+};
+
+#endif /* INC_INDICATOR_H */
@@ -18,12 +18,27 @@
 
 #include <cstdlib>
 #include <algorithm>
+#include <cassert>
 
 #include "invaders.h"
 #include "state.h"
 #include "geom.h"
 #include "random.h"
 #include "collision.h"
+#include "pool.h"
+
+template<> const PoolClass Pooled<EggInvader>::poolClass(
+	sizeof(EggInvader), "EggInvader");
+template<> const PoolClass Pooled<KamikazeInvader>::poolClass(
+	sizeof(KamikazeInvader), "KamikazeInvader");
+template<> const PoolClass Pooled<SplittingInvader>::poolClass(
+	sizeof(SplittingInvader), "SplittingInvader");
+template<> const PoolClass Pooled<InfestingInvader>::poolClass(
+	sizeof(InfestingInvader), "InfestingInvader");
+template<> const PoolClass Pooled<CapturePod>::poolClass(
+	sizeof(CapturePod), "CapturePod");
+template<> const PoolClass Pooled<FoulEggLayingInvader>::poolClass(
+	sizeof(FoulEggLayingInvader), "FoulEggLayingInvader");
 
 using namespace std;
 
@@ -35,9 +50,12 @@ void Invader::update(int time)
     setCollTrajectory(startPos, velocity);
 }
 
-void Invader::spawnInvader(Invader* invader)
+void Invader::spawnEgg(RelPolarCoord pos, float ds)
 {
-    spawns.push_back(invader);
+    assert(numSpawns < MAX_SPAWNS);
+    spawns[numSpawns].pos = pos;
+    spawns[numSpawns].ds = ds;
+    numSpawns++;
 }
 
 const CollisionObject& CircularInvader::collObj() const
@@ -74,7 +92,7 @@ void KamikazeInvader::doUpdate(int time)
 
     if (kamikaze == 0)
     {
-	if (rani(3000) <= time && rani(ARENA_RAD/2) > pos.dist)
+	if (rng->rani(3000) <= time && rng->rani(ARENA_RAD/2) > pos.dist)
 	    kamikaze = 1;
     }
     else
@@ -108,9 +126,9 @@ void SplittingInvader::doUpdate(int time)
     {
 	if (hp > 1)
 	    for (int dds = -1; dds <= 1; dds += 2)
-		spawnInvader(new EggInvader(pos, ds+dds));
+		spawnEgg(pos, ds+dds);
 	else
-	    spawnInvader(new EggInvader(pos, ds));
+	    spawnEgg(pos, ds);
 	die();
     }
 }
@@ -245,20 +263,21 @@ SpirallingPolygonalInvader::SpirallingPolygonalInvader(int inumPoints,
 	RelPolarCoord ipos, float ids, float idd, CartCoord ifocus) :
     SpirallingInvader(ipos, ids, idd, ifocus),
     numPoints(inumPoints),
-    points(new RelCartCoord[numPoints]),
-    cp(inumPoints, points)
+    cp(numPoints, points)
 {
+    assert(inumPoints <= MAX_POINTS);
 }
 
+// The copy needs its collision polygon pointing at its own points.
 SpirallingPolygonalInvader::SpirallingPolygonalInvader(
 	const SpirallingPolygonalInvader& other) :
-    SpirallingInvader(other.pos, other.ds, other.dd, other.focus),
+    SpirallingInvader(other),
     numPoints(other.numPoints),
-    points(new RelCartCoord[numPoints]),
-    cp(other.numPoints, points)
+    cp(other.cp)
 {
     for (int i = 0; i < numPoints; i++)
 	points[i] = other.points[i];
+    cp.points = points;
 }
 
 SpirallingPolygonalInvader& SpirallingPolygonalInvader::operator=(
@@ -266,21 +285,16 @@ SpirallingPolygonalInvader& SpirallingPolygonalInvader::operator=(
 {
     if (this != &other)
     {
-	pos = other.pos; ds = other.ds; dd = other.dd; focus = other.focus;
+	SpirallingInvader::operator=(other);
 	numPoints = other.numPoints;
-	points = new RelCartCoord[numPoints];
-	cp = other.cp;
 	for (int i = 0; i < numPoints; i++)
 	    points[i] = other.points[i];
+	cp = other.cp;
+	cp.points = points;
     }
     return *this;
 }
 
-SpirallingPolygonalInvader::~SpirallingPolygonalInvader()
-{
-    delete[] points;
-}
-
 void SpirallingPolygonalInvader::getAbsPoints(CartCoord* absPoints) const
 {
     for (int i=0; i<numPoints; i++)
@@ -290,7 +304,7 @@ void SpirallingPolygonalInvader::getAbsPoints(CartCoord* absPoints) const
 void SpirallingPolygonalInvader::draw(SDL_Surface* surface, const View& view,
 	View* boundView, bool noAA) const
 {
-    CartCoord* absPoints = new CartCoord[numPoints];
+    CartCoord absPoints[MAX_POINTS];
 
     getAbsPoints(absPoints);
 
@@ -300,8 +314,6 @@ void SpirallingPolygonalInvader::draw(SDL_Surface* surface, const View& view,
 		surface, view, boundView, noAA);
 
     Polygon(absPoints, numPoints, colour()).draw(surface, view, boundView, noAA);
-
-    delete[] absPoints;
 }
 
 void FoulEggLayingInvader::draw(SDL_Surface* surface, const View& view,
@@ -309,15 +321,13 @@ void FoulEggLayingInvader::draw(SDL_Surface* surface, const View& view,
 {
     SpirallingPolygonalInvader::draw(surface, view, boundView, noAA);
 
-    CartCoord* absPoints = new CartCoord[numPoints];
+    CartCoord absPoints[MAX_POINTS];
     getAbsPoints(absPoints);
 
     if (eggRadius > 0)
 	Circle(absPoints[4] + (
 		    RelCartCoord(0, -eggRadius).rotated(pos.angle)),
 		eggRadius, 0xff0000ff).draw(surface, view, boundView, noAA);
-
-    delete[] absPoints;
 }
 
 
@@ -361,8 +371,7 @@ void FoulEggLayingInvader::doUpdate(int time)
     if (eggRadius >= layRadius)
     {
 	RelPolarCoord p(pos.angle, pos.dist + points[4].dy - eggRadius);
-	Invader* egg = new EggInvader(p, ds);
-	spawnInvader(egg);
+	spawnEgg(p, ds);
 
 	eggRadius = 0;
     }
@@ -384,18 +393,23 @@ int FoulEggLayingInvader::hit(int weight)
 EggInvader::EggInvader(RelPolarCoord ipos, float ids, bool super) :
     BasicInvader(1, ipos, ids, 3+super*1.5, 5, super)
 {}
-KamikazeInvader::KamikazeInvader(RelPolarCoord ipos, float ids, bool super) :
-    BasicInvader(2, ipos, ids, 2+super*1.5, 6, super), kamikaze(0), timer(0)
+KamikazeInvader::KamikazeInvader(Random& rng, RelPolarCoord ipos, float ids,
+	bool super) :
+    BasicInvader(2, ipos, ids, 2+super*1.5, 6, super), kamikaze(0), timer(0),
+    rng(&rng)
 {}
-SplittingInvader::SplittingInvader(RelPolarCoord ipos, float ids, bool super) :
+SplittingInvader::SplittingInvader(Random& rng, RelPolarCoord ipos, float ids,
+	bool super) :
     BasicInvader(3, ipos, ids, 1+super*1.5, 7, super)
 {
-    spawnDist = ARENA_RAD/10 + rani(4*ARENA_RAD/10);
+    spawnDist = ARENA_RAD/10 + rng.rani(4*ARENA_RAD/10);
 }
-InfestingInvader::InfestingInvader(Node* itargetNode, bool super) :
+InfestingInvader::InfestingInvader(Random& rng, Node* itargetNode,
+	bool super) :
     HPInvader(3,1), CircularInvader(6),
     SpirallingInvader(
-	    RelPolarCoord(itargetNode->pos.angle + ranf(0.5)-0.25, ARENA_RAD),
+	    RelPolarCoord(itargetNode->pos.angle + rng.ranf(0.5)-0.25,
+		ARENA_RAD),
 	    0, 0.5 + super*0.2),
     healRate(0.1 + super*0.025),
     partialHP(0), shownHP(3), infesting(false),
@@ -433,13 +447,13 @@ void InfestingInvader::doUpdate(int time)
 	else
 	    die();
     }
-    if (infesting && targetNode->status != NODEST_EVIL)
+    if (infesting && targetNode->status() != NODEST_EVIL)
     {
 	// Infested node has been recaptured
 	infesting = false;
 	die();
     }
-    if (dd > 0 && targetNode->status == NODEST_DESTROYED)
+    if (dd > 0 && targetNode->status() == NODEST_DESTROYED)
     {
 	dd *= -3;
     }
@@ -577,3 +591,69 @@ FoulEggLayingInvader::FoulEggLayingInvader(RelPolarCoord ipos, float ids,
 {
     setPoints(-1);
 }
+
+void InvaderStore::add(Invader* inv)
+{
+    push_back(inv);
+    pos.push_back(inv->cpos());
+    vel.push_back(RelCartCoord(0,0));
+    radius.push_back(inv->collObj().boundingRadius());
+    hitsInvaders.push_back(inv->hitsInvaders());
+    flags.push_back(
+	    (inv->hitsYou() ? IF_HITSYOU : 0) |
+	    (inv->hitsShots() ? IF_HITSSHOTS : 0) |
+	    (inv->evil() ? IF_EVIL : 0));
+    hpInvader.push_back(dynamic_cast<HPInvader*>(inv));
+    spiraller.push_back(inv->plainSpiraller());
+}
+
+void InvaderStore::record(int i, int time)
+{
+    const CollisionObject& obj = (*this)[i]->collObj();
+    vel[i] = obj.velocity;
+    pos[i] = obj.startPos + obj.velocity*time;
+    radius[i] = obj.boundingRadius();
+}
+
+void InvaderStore::removeDead()
+{
+    std::vector<Invader*>& list = *this;
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < size(); i++)
+    {
+	Invader* inv = list[i];
+	if (inv->dead())
+	{
+	    inv->onDeath();
+	    delete inv;
+	    continue;
+	}
+	if (j != i)
+	{
+	    list[j] = inv;
+	    pos[j] = pos[i];
+	    vel[j] = vel[i];
+	    radius[j] = radius[i];
+	    hitsInvaders[j] = hitsInvaders[i];
+	    flags[j] = flags[i];
+	    hpInvader[j] = hpInvader[i];
+	    spiraller[j] = spiraller[i];
+	}
+	j++;
+    }
+    resize(j);
+    pos.resize(j);
+    vel.resize(j);
+    radius.resize(j);
+    hitsInvaders.resize(j);
+    flags.resize(j);
+    hpInvader.resize(j);
+    spiraller.resize(j);
+}
+
+InvaderStore::~InvaderStore()
+{
+    // return the invaders to the game's pools before the pools go
+    for (unsigned int i = 0; i < size(); i++)
+	delete (*this)[i];
+}
@@ -9,8 +9,11 @@
 #include "collision.h"
 #include "geom.h"
 #include "ai.h"
+#include "pool.h"
+#include "random.h"
 
 class Node;
+class SpirallingInvader;
 
 class Invader
 {
@@ -52,15 +55,30 @@ class Invader
 
 	virtual void dodge() {};
 
-	std::vector<Invader*> spawns;
-	void spawnInvader(Invader* invader);
+	// plainSpiraller: this invader as a SpirallingInvader, if its update
+	// is exactly SpirallingInvader::doUpdate and so may be done in a batch
+	// by spiralStep; NULL otherwise
+	virtual SpirallingInvader* plainSpiraller() { return NULL; }
+
+	// spawns: eggs laid by this invader during its last update, for the
+	// caller to create in the game's PoolArena and add to the game; an
+	// invader may spawn at most MAX_SPAWNS per update
+	struct Spawn
+	{
+	    RelPolarCoord pos;
+	    float ds;
+	};
+	static const int MAX_SPAWNS = 2;
+	Spawn spawns[MAX_SPAWNS];
+	int numSpawns;
+	void spawnEgg(RelPolarCoord pos, float ds);
 
 	AIData aiData;
 
 	virtual void draw(SDL_Surface* surface, const View& view, View*
 		boundView=NULL, bool noAA=false) const =0;
 
-	Invader() {}
+	Invader() : numSpawns(0) {}
 	virtual ~Invader() {};
 };
 
@@ -122,8 +140,11 @@ class SpirallingPolygonalInvader : public SpirallingInvader
 	void getAbsPoints(CartCoord* absPoints) const;
 
     public:
+	// points: held inline, so that constructing and copying polygonal
+	// invaders needn't allocate; a polygon may have at most MAX_POINTS
+	static const int MAX_POINTS = 5;
 	int numPoints;
-	RelCartCoord* points;
+	RelCartCoord points[MAX_POINTS];
 
 	CollisionPolygon cp;
 	const CollisionObject& collObj() const;
@@ -140,8 +161,6 @@ class SpirallingPolygonalInvader : public SpirallingInvader
 
 	SpirallingPolygonalInvader& operator=(
 		const SpirallingPolygonalInvader& other);
-
-	virtual ~SpirallingPolygonalInvader();
 };
 
 class BasicInvader : public HPInvader, public SpirallingInvader, public
@@ -162,12 +181,15 @@ class BasicInvader : public HPInvader, public SpirallingInvader, public
 	{}
 };
 
-class EggInvader : public BasicInvader
+class EggInvader : public BasicInvader, public Pooled<EggInvader>
 {
     public:
+	SpirallingInvader* plainSpiraller() { return this; }
+
 	EggInvader(RelPolarCoord ipos, float ids=0, bool super=false);
 };
-class KamikazeInvader : public BasicInvader
+class KamikazeInvader : public BasicInvader,
+    public Pooled<KamikazeInvader>
 {
     protected:
 	void doUpdate(int time);
@@ -176,22 +198,27 @@ class KamikazeInvader : public BasicInvader
     private:
 	int kamikaze;
 	int timer;
+	Random* rng;
 
     public:
-	KamikazeInvader(RelPolarCoord ipos, float ids=0, bool super=false);
+	KamikazeInvader(Random& rng, RelPolarCoord ipos, float ids=0,
+		bool super=false);
 };
-class SplittingInvader : public BasicInvader
+class SplittingInvader : public BasicInvader,
+    public Pooled<SplittingInvader>
 {
     private:
 	float spawnDist;
     protected:
 	void doUpdate(int time);
     public:
-	SplittingInvader(RelPolarCoord ipos, float ids=0, bool super=false);
+	SplittingInvader(Random& rng, RelPolarCoord ipos, float ids=0,
+		bool super=false);
 	void draw(SDL_Surface* surface, const View& view, View*
 	    boundView=NULL, bool noAA=false) const;
 };
-class InfestingInvader : public HPInvader, public CircularInvader, public SpirallingInvader
+class InfestingInvader : public HPInvader, public CircularInvader, public SpirallingInvader,
+    public Pooled<InfestingInvader>
 {
     private:
 	float healRate;
@@ -211,13 +238,14 @@ class InfestingInvader : public HPInvader, public CircularInvader, public Spiral
 
 	void fleeOnWin();
 
-	InfestingInvader(Node* itargetNode, bool super=false);
+	InfestingInvader(Random& rng, Node* itargetNode, bool super=false);
 	void draw(SDL_Surface* surface, const View& view, View*
 	    boundView=NULL, bool noAA=false) const;
 	void onDeath() const;
 };
 
-class CapturePod : public HPInvader, public CircularInvader, public SpirallingInvader
+class CapturePod : public HPInvader, public CircularInvader, public SpirallingInvader,
+    public Pooled<CapturePod>
 {
     private:
 	Node* targetNode;
@@ -241,7 +269,7 @@ class CapturePod : public HPInvader, public CircularInvader, public SpirallingIn
 };
 
 class FoulEggLayingInvader : public HPInvader,
-    public SpirallingPolygonalInvader
+    public SpirallingPolygonalInvader, public Pooled<FoulEggLayingInvader>
 {
     protected:
 	void doUpdate(int time);
@@ -262,4 +290,55 @@ class FoulEggLayingInvader : public HPInvader,
 	FoulEggLayingInvader(RelPolarCoord ipos, float ids=0, int ihp=5);
 };
 
+// the pooled invader classes, defined in invaders.cc
+template<> const PoolClass Pooled<EggInvader>::poolClass;
+template<> const PoolClass Pooled<KamikazeInvader>::poolClass;
+template<> const PoolClass Pooled<SplittingInvader>::poolClass;
+template<> const PoolClass Pooled<InfestingInvader>::poolClass;
+template<> const PoolClass Pooled<CapturePod>::poolClass;
+template<> const PoolClass Pooled<FoulEggLayingInvader>::poolClass;
+
+// InvaderStore: the list of live invaders, along with a copy of their hot
+// per-step data held in parallel arrays, so that the collision, AI and
+// culling passes can scan it linearly rather than going through the virtual
+// interface of each invader in turn. Entry i of each array describes
+// (*this)[i]. The Invader objects remain authoritative; 'record' copies
+// from an invader after it has been updated.
+//
+// The list itself is only changed by 'add' and 'removeDead', which keep the
+// arrays in step with it. The store owns its invaders, and deletes any left
+// when it is destroyed.
+class InvaderStore : private std::vector<Invader*>
+{
+    public:
+	static const Uint8 IF_HITSYOU = 1<<0;
+	static const Uint8 IF_HITSSHOTS = 1<<1;
+	static const Uint8 IF_EVIL = 1<<2;
+
+	// pos: current absolute position; vel: velocity over the last update
+	std::vector<CartCoord> pos;
+	std::vector<RelCartCoord> vel;
+	// radius: bounding radius of the collision object
+	std::vector<float> radius;
+	// hitsInvaders: as Invader::hitsInvaders()
+	std::vector<float> hitsInvaders;
+	std::vector<Uint8> flags;
+	// hpInvader: the invader as an HPInvader, or NULL if it isn't one
+	std::vector<HPInvader*> hpInvader;
+	// spiraller: as Invader::plainSpiraller()
+	std::vector<SpirallingInvader*> spiraller;
+
+	using std::vector<Invader*>::size;
+	Invader* operator[](unsigned int i) const
+	{ return std::vector<Invader*>::operator[](i); }
+
+	void add(Invader* inv);
+	void record(int i, int time);
+
+	// removeDead: remove, call onDeath on, and delete the dead invaders
+	void removeDead();
+
+	~InvaderStore();
+};
+
 #endif /* INC_INVADERS_H */
@@ -26,6 +26,10 @@
 #include <cstdio>
 #include <ctime>
 #include <stack>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <unistd.h>
 #include <SDL/SDL.h>
 #include <SDL_gfxPrimitivesDirty.h>
 #include <string>
@@ -44,6 +48,10 @@
 #include "keybindings.h"
 #include "sound.h"
 #include "background.h"
+#include "pool.h"
+#include "replay.h"
+#include "textcache.h"
+#include "selftest.h"
 
 #ifdef HIGH_SCORE_REPORTING
 # include "highScore.h"
@@ -57,6 +65,56 @@
 SDL_Surface* screen = NULL;
 std::stack<Menu*> menuStack;
 
+// rng: randomness outside of games, e.g. for backgrounds
+Random rng;
+
+// newGameSeed: the seed for the next game; the n'th game of a run gets
+// settings.seed + n
+Uint32 newGameSeed()
+{
+    static Uint32 games = 0;
+    return settings.seed + games++;
+}
+
+// playback: the replay being played, if settings.playbackFile is set
+Replay playback;
+
+// newGameState: start a game. When playing back, this is the replay's game
+// from the start, with no AI. Otherwise it is a fresh game, played by an AI
+// if 'withAI'; it is recorded if a record file is set, except for the AI
+// games shown between interactive games.
+GameState* newGameState(bool withAI)
+{
+    if (!settings.playbackFile.empty())
+    {
+	playback.rewind();
+	return new GameState(playback.speed, playback.seed, playback.rating);
+    }
+
+    GameState* gameState = new GameState(settings.speed, newGameSeed());
+    if (withAI)
+	gameState->ai = new BasicAI(gameState);
+    if (!settings.recordFile.empty() &&
+	    (!withAI || settings.headlessGames > 0))
+	gameState->recording = new Replay(gameState->seed, gameState->speed,
+		gameState->rating);
+    return gameState;
+}
+
+// endGameState: finish with a game, saving its recording if it has one
+void endGameState(GameState* gameState)
+{
+    if (gameState->recording)
+    {
+	if (!gameState->recording->save(settings.recordFile.c_str()))
+	    fprintf(stderr, "Failed to save replay to %s\n",
+		    settings.recordFile.c_str());
+	delete gameState->recording;
+    }
+    delete gameState->ai;
+    delete gameState;
+}
+
 enum EventsReturn
 {
     ER_NONE,
@@ -85,8 +143,9 @@ bool setVideoMode()
 
     screen = ret;
     screenGeom = ScreenGeom(settings.width, settings.height);
+    textCache.clear();
 
-    setBackground(screen);
+    requestBackground(screen, rng);
     setDirty(screen, background);
 
     return true;
@@ -178,7 +237,7 @@ EventsReturn handleCommand(command c, GameState* gameState, GameClock& gameClock
 	    break;
 	case C_WIN:
 	    if (settings.debug)
-		gameState->end = END_WIN;
+		gameState->forceEnd(END_WIN);
 	    break;
 
 #ifdef HIGH_SCORE_REPORTING
@@ -293,63 +352,188 @@ EventsReturn process_events(GameState* gameState, GameClock& gameClock)
     return ER_NONE;
 }
 
+#ifdef DEBUG
+// frameAllocs: calls to operator new made in drawing the game state in the
+// last frame; shown in debug mode. Allocations made by C code, such as
+// SDL_CreateRGBSurface or SDL_gfx's mallocs, aren't counted, so a zero
+// here doesn't show the drawing allocates nothing; and allocations by the
+// background thread meanwhile are, so a nonzero count may not be ours.
+static unsigned long frameAllocs = 0;
+#endif
+
+// presentedPixels: pixels sent to the display in the last frame
+static long presentedPixels = 0;
+
+// presentFrame: show the frame drawn to surface. With partial updates, only
+// the parts drawn on this frame or blanked after the last are updated; this
+// needs a single-buffered surface, since with double buffering SDL_Flip
+// swaps the whole buffer.
+void presentFrame(SDL_Surface* surface)
+{
+    if (settings.partialUpdates && !(surface->flags & SDL_DOUBLEBUF))
+    {
+	SDL_Rect* rects;
+	const int n = getChangedRects(&rects, &presentedPixels);
+	if (n > 0)
+	    SDL_UpdateRects(surface, n, rects);
+    }
+    else
+    {
+	SDL_Flip(surface);
+	presentedPixels = long(surface->w) * surface->h;
+    }
+}
+
+// InfoInputs: what the info lines show, so that they need be formatted
+// only when it changes
+struct InfoInputs
+{
+    int shownFPS;
+    bool paused;
+    double rating;
+    int speed;
+    int rate;
+    bool debug;
+    int maxLength;
+
+    bool operator!=(const InfoInputs& o) const
+    {
+	return shownFPS != o.shownFPS || paused != o.paused ||
+	    rating != o.rating || speed != o.speed || rate != o.rate ||
+	    debug != o.debug || maxLength != o.maxLength;
+    }
+};
+
 void drawInfo(SDL_Surface* surface, GameState* gameState,
 	GameClock& gameClock, float observedFPS)
 {
-    int shownFPS = int(round(observedFPS));
-    char fpsStr[5+10+9];
-    snprintf(fpsStr, 5+10+9, "fps: %d/%d%s", shownFPS,
-	    settings.fps, gameClock.paused ? " [Paused]" : "");
-
-    char ratingStr[8+20+7+3];
-    snprintf(ratingStr, 8+20+7+3, "rating: %.1f %s (%s)",
-	    gameState->rating, ratingString((int)(gameState->rating)),
-	    speedStringShort(gameState->speed));
-
-    char rateStr[6+5+10];
-    snprintf(rateStr, 6+5+10, "speed: %d.%d%s", gameClock.rate/1000,
-	    (gameClock.rate%1000)/100, settings.debug ? " [*DEBUG*]" : "");
-
-    // if not enough room, try short version; if still too long don't display:
-    if ((int)strlen(fpsStr) > screenGeom.infoMaxLength)
-	snprintf(fpsStr, 5+10+9, "F: %d%s", shownFPS,
-		gameClock.paused ? " [P]" : "" );
-    if ((int)strlen(fpsStr) > screenGeom.infoMaxLength)
-	*fpsStr = '\0';
-
-    if ((int)strlen(ratingStr) > screenGeom.infoMaxLength)
-	snprintf(ratingStr, 8+20+7+5, "R: %.1f (%s)", gameState->rating,
-		speedStringShort(gameState->speed));
-    if ((int)strlen(ratingStr) > screenGeom.infoMaxLength)
-	*ratingStr = '\0';
-
-    if ((int)strlen(rateStr) > screenGeom.infoMaxLength)
-	snprintf(rateStr, 6+5+9, "S: %d.%d%s", gameClock.rate/1000,
-		(gameClock.rate%1000)/100, settings.debug ? " [D]" : "");
-    if ((int)strlen(rateStr) > screenGeom.infoMaxLength)
-	*rateStr = '\0';
-
-    gfxPrimitivesSetFont(fontSmall,7,13);
+    InfoInputs in;
+    in.shownFPS = int(round(observedFPS));
+    in.paused = gameClock.paused;
+    in.rating = gameState->rating;
+    in.speed = gameState->speed;
+    in.rate = gameClock.rate;
+    in.debug = settings.debug;
+    in.maxLength = screenGeom.infoMaxLength;
+
+    static InfoInputs lastIn;
+    static bool formatted = false;
+    static char fpsStr[5+10+9];
+    static char ratingStr[8+20+7+3];
+    static char rateStr[6+5+10];
+
+    if (!formatted || in != lastIn)
+    {
+	snprintf(fpsStr, 5+10+9, "fps: %d/%d%s", in.shownFPS,
+		settings.fps, in.paused ? " [Paused]" : "");
+
+	snprintf(ratingStr, 8+20+7+3, "rating: %.1f %s (%s)",
+		in.rating, ratingString((int)(in.rating)),
+		speedStringShort(in.speed));
+
+	snprintf(rateStr, 6+5+10, "speed: %d.%d%s", in.rate/1000,
+		(in.rate%1000)/100, in.debug ? " [*DEBUG*]" : "");
+
+	// if not enough room, try short version; if still too long don't
+	// display:
+	if ((int)strlen(fpsStr) > in.maxLength)
+	    snprintf(fpsStr, 5+10+9, "F: %d%s", in.shownFPS,
+		    in.paused ? " [P]" : "" );
+	if ((int)strlen(fpsStr) > in.maxLength)
+	    *fpsStr = '\0';
+
+	if ((int)strlen(ratingStr) > in.maxLength)
+	    snprintf(ratingStr, 8+20+7+5, "R: %.1f (%s)", in.rating,
+		    speedStringShort(in.speed));
+	if ((int)strlen(ratingStr) > in.maxLength)
+	    *ratingStr = '\0';
+
+	if ((int)strlen(rateStr) > in.maxLength)
+	    snprintf(rateStr, 6+5+9, "S: %d.%d%s", in.rate/1000,
+		    (in.rate%1000)/100, in.debug ? " [D]" : "");
+	if ((int)strlen(rateStr) > in.maxLength)
+	    *rateStr = '\0';
+
+	lastIn = in;
+	formatted = true;
+    }
 
     int line = 0;
     if (settings.showFPS)
-	stringColor(surface,
+	textCache.draw(surface,
 		screenGeom.info.x, screenGeom.info.y+15*line++,
-		fpsStr, 0xffffffff);
+		fpsStr, fontSmall, 7, 13, 0xffffffff);
 
 
     if (screenGeom.infoMaxLines > line)
     {
-	stringColor(surface,
+	textCache.draw(surface,
 		screenGeom.info.x, screenGeom.info.y+15*line++,
-		ratingStr, 0xffffffff);
+		ratingStr, fontSmall, 7, 13, 0xffffffff);
     }
 
     if ( (settings.debug || gameClock.rate != rateOfSpeed(gameState->speed))
 	    && screenGeom.infoMaxLines > line)
-	stringColor(surface,
+	textCache.draw(surface,
 		screenGeom.info.x, screenGeom.info.y+15*line++,
-		rateStr, 0xffffffff);
+		rateStr, fontSmall, 7, 13, 0xffffffff);
+
+#ifdef DEBUG
+    if (settings.debug && screenGeom.infoMaxLines > line)
+    {
+	char allocStr[5+20];
+	snprintf(allocStr, 5+20, "new: %lu", frameAllocs);
+	if ((int)strlen(allocStr) <= screenGeom.infoMaxLength)
+	    textCache.draw(surface,
+		    screenGeom.info.x, screenGeom.info.y+15*line++,
+		    allocStr, fontSmall, 7, 13, 0xffffffff);
+    }
+#endif
+
+    if (settings.debug && screenGeom.infoMaxLines > line)
+    {
+	char drawStr[6+10+8+10+3+10+21];
+	snprintf(drawStr, 6+10+8+10+3+10+21, "prims: %d in %ums; px: %ld",
+		drawList.lastCommands - drawList.lastCulled,
+		drawList.lastFlushTicks, presentedPixels);
+	if ((int)strlen(drawStr) <= screenGeom.infoMaxLength)
+	    textCache.draw(surface,
+		    screenGeom.info.x, screenGeom.info.y+15*line++,
+		    drawStr, fontSmall, 7, 13, 0xffffffff);
+    }
+
+    if (settings.debug && screenGeom.infoMaxLines > line)
+    {
+	// hit rate of the glyph cache since the last frame
+	static unsigned long lastHits = 0, lastMisses = 0;
+	unsigned long hits, misses;
+	gfxPrimitivesGlyphStats(&hits, &misses);
+	const unsigned long drawn = (hits-lastHits) + (misses-lastMisses);
+	char glyphStr[14+6];
+	snprintf(glyphStr, 14+6, "glyph hits: %.1f%%",
+		drawn ? 100.0*(hits-lastHits)/drawn : 100.0);
+	lastHits = hits;
+	lastMisses = misses;
+	if ((int)strlen(glyphStr) <= screenGeom.infoMaxLength)
+	    textCache.draw(surface,
+		    screenGeom.info.x, screenGeom.info.y+15*line++,
+		    glyphStr, fontSmall, 7, 13, 0xffffffff);
+    }
+
+    if (settings.debug && screenGeom.infoMaxLines > line)
+    {
+	// backgrounds drawn ahead, and the time to draw one
+	int numReady;
+	Uint32 drawTicks;
+	backgroundStats(&numReady, &drawTicks);
+	char bgStr[5+10+9+10+3];
+	snprintf(bgStr, 5+10+9+10+3, "bgs: %d ready, %ums each",
+		numReady, drawTicks);
+	if ((int)strlen(bgStr) <= screenGeom.infoMaxLength)
+	    textCache.draw(surface,
+		    screenGeom.info.x, screenGeom.info.y+15*line++,
+		    bgStr, fontSmall, 7, 13, 0xffffffff);
+    }
 }
 
 void drawSplash(SDL_Surface* surface)
@@ -365,15 +549,15 @@ void drawSplash(SDL_Surface* surface)
 	std::min(0x60, (int)(SDL_GetTicks()/500) +
 		(menuStack.empty() ? 0 : 0x40));
 
-    gfxPrimitivesSetFont(fontBig, 10, 20);
-
     if (x > 0)
-	stringColor(surface, x, y, "K U K L O M E N O S", titleColour);
+	textCache.draw(surface, x, y, "K U K L O M E N O S",
+		fontBig, 10, 20, titleColour);
     else
     {
 	// Not enough room for that
 	x = screenGeom.centre.x - 10*10/2;
-	stringColor(surface, x, y, "KUKLOMENOS", titleColour);
+	textCache.draw(surface, x, y, "KUKLOMENOS",
+		fontBig, 10, 20, titleColour);
     }
 
     static Overlay splashInstructOverlay(0.35);
@@ -397,18 +581,20 @@ void drawSplash(SDL_Surface* surface)
 
 void initialize_system()
 {
-    /* Initialize SDL */
-    if ( SDL_Init(SDL_INIT_EVERYTHING) < 0 ) {
+    /* Initialize SDL; headless simulation needs only the timer */
+    if ( SDL_Init(settings.headlessGames || settings.farmGames ?
+		SDL_INIT_TIMER :
+		SDL_INIT_EVERYTHING) < 0 ) {
 	fprintf(stderr,
 		"Couldn't initialize SDL: %s\n", SDL_GetError());
 	exit(1);
     }
     atexit(SDL_Quit);			/* Clean up on exit */
+    atexit(finishBackground);		/* ...after the background thread */
 
     SDL_EnableKeyRepeat(SDL_DEFAULT_REPEAT_DELAY, SDL_DEFAULT_REPEAT_INTERVAL);
 
-    // set random seed
-    srand(time(NULL));
+    rng.seed(settings.seed);
 }
 
 void initialize_video()
@@ -493,11 +679,264 @@ void initialize_video()
     }
 
     screenGeom = ScreenGeom(settings.width, settings.height);
+    textCache.clear();
 
-    setBackground(screen);
+    requestBackground(screen, rng);
     setDirty(screen, background);
 }
 
+const int MIN_GAME_STEP = 30;
+
+const char* endStateString(EndState end)
+{
+    switch (end)
+    {
+	case END_DEAD: return "dead";
+	case END_EXTRACTED: return "extracted";
+	case END_WIN: return "win";
+	default: return "unfinished";
+    }
+}
+
+// games which go on longer than this (in game-time ms) are abandoned
+const unsigned int MAX_GAME_TICKS = 60*60*1000;
+
+// playAIGame: step a game played by its AI until it ends or is abandoned
+void playAIGame(GameState* gameState, GameClock& gameClock)
+{
+    while (!gameState->end && gameClock.ticks < MAX_GAME_TICKS)
+    {
+	gameState->update(MIN_GAME_STEP);
+	gameClock.updatePreScaled(MIN_GAME_STEP);
+    }
+}
+
+// run_headless: play settings.headlessGames AI games back to back, stepping
+// the state as fast as possible with no drawing, delays or sound, and report
+// the outcome of each on stdout.
+void run_headless()
+{
+    int endCounts[4] = { 0, 0, 0, 0 };
+    double totalTicks = 0;
+    unsigned long totalCollisionTests = 0;
+    const Uint32 startTicks = SDL_GetTicks();
+
+    for (int game = 1; game <= settings.headlessGames; game++)
+    {
+	GameState* gameState = newGameState(true);
+	GameClock gameClock(rateOfSpeed(gameState->speed));
+
+	if (settings.playbackFile.empty())
+	    playAIGame(gameState, gameClock);
+	else
+	{
+	    ReplayStep step;
+	    while (!gameState->end && gameClock.ticks < MAX_GAME_TICKS &&
+		    playback.next(step))
+	    {
+		gameState->replayStep(step);
+		gameClock.updatePreScaled(step.time);
+	    }
+	}
+
+	printf("game %d (seed %u): %s score %d rating %.1f time %u.%03us\n",
+		game, gameState->seed,
+		endStateString(gameState->end), gameState->you.score,
+		gameState->rating, gameClock.ticks/1000, gameClock.ticks%1000);
+
+	endCounts[gameState->end]++;
+	totalTicks += gameClock.ticks;
+	totalCollisionTests += gameState->collisionTests;
+
+	endGameState(gameState);
+    }
+
+    const Uint32 realTicks = SDL_GetTicks() - startTicks;
+    printf("%d games in %u ms: %d won, %d dead, %d extracted, %d unfinished;"
+	    " mean game time %.1fs; %lu collision tests\n",
+	    settings.headlessGames, realTicks,
+	    endCounts[END_WIN], endCounts[END_DEAD], endCounts[END_EXTRACTED],
+	    endCounts[END_NOT], totalTicks/settings.headlessGames/1000,
+	    totalCollisionTests);
+    PoolClass::printStats();
+}
+
+// FarmGame: one game of a farm, and once it has been played, its outcome
+struct FarmGame
+{
+    Uint32 seed;
+    double rating;
+
+    EndState end;
+    int score;
+    unsigned int ticks;
+};
+
+// FarmWorker: a thread of a farm, with its own queue of games (by index into
+// 'games'). A worker plays games from the back of its own queue, and once
+// that is empty steals from the front of the others', so that no thread is
+// left idle while there are games still waiting.
+struct FarmWorker
+{
+    SDL_mutex* lock;
+    std::deque<int> queue;
+
+    std::vector<FarmWorker>* workers;
+    std::vector<FarmGame>* games;
+    int index;
+};
+
+// farmTake: take a game from the back of a worker's queue, or the front if
+// 'steal'; false if it has none
+bool farmTake(FarmWorker& worker, int& game, bool steal)
+{
+    SDL_mutexP(worker.lock);
+    const bool took = !worker.queue.empty();
+    if (took && steal)
+    {
+	game = worker.queue.front();
+	worker.queue.pop_front();
+    }
+    else if (took)
+    {
+	game = worker.queue.back();
+	worker.queue.pop_back();
+    }
+    SDL_mutexV(worker.lock);
+    return took;
+}
+
+// farmThread: play games until there are none left anywhere. No game is
+// queued once the threads have started, so a worker which finds every queue
+// empty is done.
+int farmThread(void* data)
+{
+    FarmWorker& self = *static_cast<FarmWorker*>(data);
+    std::vector<FarmWorker>& workers = *self.workers;
+
+    int game;
+    while (true)
+    {
+	bool took = farmTake(self, game, false);
+	for (unsigned int i = 1; !took && i < workers.size(); i++)
+	    took = farmTake(workers[(self.index + i) % workers.size()],
+		    game, true);
+	if (!took)
+	    break;
+
+	FarmGame& farmGame = (*self.games)[game];
+	GameState* gameState = new GameState(settings.speed, farmGame.seed,
+		farmGame.rating);
+	gameState->ai = new BasicAI(gameState);
+	GameClock gameClock(rateOfSpeed(gameState->speed));
+
+	playAIGame(gameState, gameClock);
+
+	farmGame.end = gameState->end;
+	farmGame.score = gameState->you.score;
+	farmGame.ticks = gameClock.ticks;
+
+	delete gameState->ai;
+	delete gameState;
+    }
+    return 0;
+}
+
+// run_farm: play settings.farmGames AI games on settings.farmThreads threads,
+// and report their outcomes by rating and speed. Game n (from 0) has seed
+// settings.seed + n, as in run_headless, and rating settings.requestedRating
+// if given, else 1 + n%9 so as to cover the range. Each game allocates
+// from its own pools, so the games share no state but the pool statistics
+// they add to as they end; settings are fixed before the threads start.
+void run_farm()
+{
+    int threads = settings.farmThreads;
+#ifdef _SC_NPROCESSORS_ONLN
+    if (threads == 0)
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (threads < 1)
+	threads = 1;
+    threads = std::min(threads, settings.farmGames);
+
+    std::vector<FarmGame> games(settings.farmGames);
+    for (int n = 0; n < settings.farmGames; n++)
+    {
+	games[n].seed = settings.seed + n;
+	games[n].rating = settings.requestedRating > 0 ?
+	    settings.requestedRating : 1 + n%9;
+    }
+
+    // deal the games out in contiguous blocks; stealing evens out the
+    // differences in game length
+    std::vector<FarmWorker> workers(threads);
+    for (int i = 0; i < threads; i++)
+    {
+	workers[i].lock = SDL_CreateMutex();
+	workers[i].workers = &workers;
+	workers[i].games = &games;
+	workers[i].index = i;
+	for (int n = settings.farmGames*i/threads;
+		n < settings.farmGames*(i+1)/threads; n++)
+	    workers[i].queue.push_back(n);
+    }
+
+    const Uint32 startTicks = SDL_GetTicks();
+
+    std::vector<SDL_Thread*> running;
+    for (int i = 0; i < threads; i++)
+	running.push_back(SDL_CreateThread(farmThread, &workers[i]));
+    for (int i = 0; i < threads; i++)
+	SDL_WaitThread(running[i], NULL);
+    for (int i = 0; i < threads; i++)
+	SDL_DestroyMutex(workers[i].lock);
+
+    const Uint32 realTicks = SDL_GetTicks() - startTicks;
+
+    // group the games by rating; they all have the same speed
+    std::map<double, std::vector<const FarmGame*> > byRating;
+    for (std::vector<FarmGame>::const_iterator it = games.begin();
+	    it != games.end();
+	    it++)
+	byRating[it->rating].push_back(&*it);
+
+    for (std::map<double, std::vector<const FarmGame*> >::const_iterator
+	    it = byRating.begin();
+	    it != byRating.end();
+	    it++)
+    {
+	const std::vector<const FarmGame*>& group = it->second;
+	const int n = group.size();
+
+	int endCounts[4] = { 0, 0, 0, 0 };
+	double totalTicks = 0;
+	double totalScore = 0;
+	std::vector<int> scores;
+	for (int i = 0; i < n; i++)
+	{
+	    endCounts[group[i]->end]++;
+	    totalTicks += group[i]->ticks;
+	    totalScore += group[i]->score;
+	    scores.push_back(group[i]->score);
+	}
+	std::sort(scores.begin(), scores.end());
+
+	printf("rating %.1f speed %s: %d games: %.1f%% won, %.1f%% dead,"
+		" %.1f%% extracted, %.1f%% unfinished; mean game time %.1fs;"
+		" score mean %.1f, min %d, quartiles %d %d %d, max %d\n",
+		it->first, speedStringShort(settings.speed), n,
+		100.0*endCounts[END_WIN]/n, 100.0*endCounts[END_DEAD]/n,
+		100.0*endCounts[END_EXTRACTED]/n, 100.0*endCounts[END_NOT]/n,
+		totalTicks/n/1000, totalScore/n,
+		scores[0], scores[n/4], scores[n/2], scores[3*n/4],
+		scores[n-1]);
+    }
+
+    printf("%d games on %d threads in %u ms\n",
+	    settings.farmGames, threads, realTicks);
+    PoolClass::printStats();
+}
+
 bool haveInput()
 {
     for (command c = C_FIRST; c <= C_LASTACTION; c = command(c+1))
@@ -512,17 +951,20 @@ void run_game()
 	    (!settings.debug || settings.wizard))
 	config.shouldUpdateRating = true;
 
-    // set up a game for the AI to play...
-    GameState* gameState = new GameState(settings.speed);
-    gameState->ai = new BasicAI(gameState);
-    GameClock gameClock(rateOfSpeed(settings.speed));
+    const bool playingBack = !settings.playbackFile.empty();
+    if (playingBack)
+	config.shouldUpdateRating = false;
+
+    // set up a game for the AI to play (or the replay)...
+    GameState* gameState = newGameState(true);
+    GameClock gameClock(rateOfSpeed(gameState->speed));
 
     // main loop
     Uint32 lastStateUpdate = 0, beforeDelay = 0;
     Uint32 ticksBefore, ticksAfter;
     Uint32 loopTicks = SDL_GetTicks();
     Uint32 AIEndTick = 0;
-    bool splash = true;
+    bool splash = !playingBack;
     int timeTillNextFrame = 0;
     int delayTime, actualDelayed, updateTime;
     float avFrameTime = 1000/settings.fps;
@@ -540,7 +982,6 @@ void run_game()
     Overlay infoOverlay(0.2, 0xffffffff);
 
     const int MIN_INPUT_STEP = 30;
-    const int MIN_GAME_STEP = 30;
 
     while ( !quit ) {
 	forceFrame = false;
@@ -558,17 +999,16 @@ void run_game()
 	    {
 		case ER_RESTART:
 		    {
-			GameState* newGameState =
-			    new GameState(settings.speed);
-			delete gameState;
-			gameState = newGameState;
-			gameClock = GameClock(rateOfSpeed(settings.speed));
+			GameState* newState = newGameState(false);
+			endGameState(gameState);
+			gameState = newState;
+			gameClock = GameClock(rateOfSpeed(gameState->speed));
 		    }
 		    ended = false;
 		    victoryOverlay.clear();
 		    infoOverlay.clear();
 		    splash = false;
-		    drawBackground(screen);
+		    requestBackground(screen, rng);
 		    lastStateUpdate = SDL_GetTicks();
 		    break;
 		case ER_QUIT:
@@ -576,19 +1016,13 @@ void run_game()
 		    break;
 		case ER_SURRENDER:
 		    if (!ended)
-			gameState->end = END_DEAD;
+			gameState->forceEnd(END_DEAD);
 		    break;
 		case ER_SCREENSHOT:
 		    wantScreenshot = true;
 		    break;
 		case ER_NEWBACKGROUND:
-		    if (!background)
-		    {
-			setBackground(screen);
-			setDirty(screen, background);
-		    }
-		    else
-			drawBackground(screen);
+		    requestBackground(screen, rng);
 		    forceFrame = true;
 		    break;
 		case ER_NOTIMETAKEN:
@@ -612,6 +1046,16 @@ void run_game()
 	    {
 		while (updateTime > 0)
 		{
+		    if (playingBack)
+		    {
+			ReplayStep step;
+			if (!playback.next(step))
+			    break;
+			gameState->replayStep(step);
+			gameClock.updatePreScaled(step.time);
+			updateTime -= step.time;
+			continue;
+		    }
 		    const int stepTime =
 			std::min( MIN_GAME_STEP, updateTime );
 		    gameState->update(stepTime, !menuStack.empty());
@@ -621,10 +1065,24 @@ void run_game()
 	    }
 	}
 
+	// the audio stage: start what the game's steps have triggered
+	soundEvents.play(gameState->sounds,
+		RelPolarCoord(gameState->you.aim.angle, gameState->zoomdist));
+
+	// swap in a new background if one has been drawn
+	if (updateBackground(screen))
+	    forceFrame = true;
+
 	ticksBefore = SDL_GetTicks();
 	if (!gameClock.paused || forceFrame)
 	{
+#ifdef DEBUG
+	    const unsigned long allocsBefore = heapAllocs;
+	    gameState->draw(screen);
+	    frameAllocs = heapAllocs - allocsBefore;
+#else
 	    gameState->draw(screen);
+#endif
 	    drawInfo(screen, gameState, gameClock, 1000.0/avFrameTime);
 	    victoryOverlay.draw(screen, menuStack.empty() ? 0xff : 0xa0);
 	    infoOverlay.draw(screen, menuStack.empty() ? 0xff : 0xa0);
@@ -632,7 +1090,7 @@ void run_game()
 		drawMenu(screen, *menuStack.top());
 	    if (splash)
 		drawSplash(screen);
-	    SDL_Flip(screen);
+	    presentFrame(screen);
 
 	    if (wantScreenshot)
 	    {
@@ -666,7 +1124,7 @@ void run_game()
 
 	timeTillNextFrame =
 	    std::max(1, (1000/settings.fps) - renderingTicks +
-		    fpsRegulatorTenthTicks/10 + (rani(10) <
+		    fpsRegulatorTenthTicks/10 + (rng.rani(10) <
 			fpsRegulatorTenthTicks%10));
 
 	if (!ended && gameState->end && !gameState->ai)
@@ -766,13 +1224,11 @@ void run_game()
 	    }
 	    else if (SDL_GetTicks() - AIEndTick > 5000)
 	    {
-		GameState* newGameState =
-		    new GameState(settings.speed);
-		delete gameState;
-		gameState = newGameState;
-		gameState->ai = new BasicAI(gameState);
-		gameClock = GameClock(rateOfSpeed(settings.speed));
-		drawBackground(screen);
+		GameState* newState = newGameState(true);
+		endGameState(gameState);
+		gameState = newState;
+		gameClock = GameClock(rateOfSpeed(gameState->speed));
+		requestBackground(screen, rng);
 		ended = false;
 	    }
 	}
@@ -793,9 +1249,12 @@ void run_game()
 
     config.write();
 
-    delete gameState->ai;
-    delete gameState;
+    endGameState(gameState);
+
+    if (settings.debug)
+	PoolClass::printStats();
 
+    finishBackground();
     SDL_Quit();
 }
 
@@ -803,7 +1262,31 @@ void run_game()
 int main(int argc, char** argv)
 {
     load_settings(argc, argv);
+    if (settings.selftest)
+	return run_selftest() ? 1 : 0;
+    if (settings.bench)
+    {
+	run_bench();
+	return 0;
+    }
     initialize_system();
+    if (!settings.playbackFile.empty() &&
+	    !playback.load(settings.playbackFile.c_str()))
+    {
+	fprintf(stderr, "Can't read replay %s\n",
+		settings.playbackFile.c_str());
+	return 1;
+    }
+    if (settings.farmGames > 0)
+    {
+	run_farm();
+	return 0;
+    }
+    if (settings.headlessGames > 0)
+    {
+	run_headless();
+	return 0;
+    }
     initialize_video();
     run_game();
 
@@ -27,6 +27,7 @@ using namespace std;
 #include "geom.h"
 #include "keybindings.h"
 #include "SDL_gfxPrimitivesDirty.h"
+#include "textcache.h"
 
 #include <config.h>
 
@@ -393,6 +394,7 @@ Menu topMenu("top",
 void drawMenu(SDL_Surface* surface, const Menu& menu)
 {
     static const Uint32 colour = 0xffffffd0;
+    const void* font = fontBig;
     int fw = 10, fh = 20;
     int menuRad = std::max(fh, screenGeom.rad/8);
     const int textRoom = std::max(std::max(std::max(
@@ -402,15 +404,13 @@ void drawMenu(SDL_Surface* surface, const Menu& menu)
 	    menu.textOfDir(3).length()*fw/2);
 
     // check we have room:
-    if (screenGeom.centre.x - menuRad - textRoom > screenGeom.rad/5)
-	gfxPrimitivesSetFont(fontBig, 10, 20);
-    else
+    if (screenGeom.centre.x - menuRad - textRoom <= screenGeom.rad/5)
     {
 	// use smaller font
+	font = fontSmall;
 	fw = 7;
 	fh = 13;
 	menuRad = std::max(fh, screenGeom.rad/10);
-	gfxPrimitivesSetFont(fontSmall, 7, 13);
     }
 
     filledCircleColor(surface, screenGeom.centre.x, screenGeom.centre.y+fh/2, screenGeom.rad/30,
@@ -447,7 +447,7 @@ void drawMenu(SDL_Surface* surface, const Menu& menu)
 		    break;
 		default:;
 	    }
-	    stringColor(surface, x, y, text.c_str(), colour);
+	    textCache.draw(surface, x, y, text, font, fw, fh, colour);
 	}
     }
 }
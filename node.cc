@@ -22,17 +22,18 @@
 #include "sound.h"
 #include "coords.h"
 
-Node::Node(RelPolarCoord pos, float ds, NodeColour nodeColour, float spinRate,
-	Angle spin, int pitch, float radius) :
+Node::Node(Random& rng, RelPolarCoord pos, float ds, NodeColour nodeColour,
+	float spinRate, Angle spin, int pitch, float radius) :
     HPInvader(1,2),
     SpirallingPolygonalInvader(3, pos, ds, 0),
-    sparkPoint(rani(3)),
+    nodeStatus(NODEST_NONE), rng(&rng),
+    sparkPoint(rng.rani(3)),
     pitch(pitch),
     radius(radius),
     spinRate(spinRate),
     spin(spin),
-    nodeColour(nodeColour),
-    status(NODEST_NONE), primed(0), primeRate(0),
+    nodeColour(nodeColour), ownership(NULL), sounds(NULL),
+    primed(0), primeRate(0),
     targettingInfester(NULL), extractionProgress(0)
 {
     setPoints();
@@ -49,23 +50,23 @@ void Node::doUpdate(int time)
 {
     SpirallingInvader::doUpdate(time);
 
-    if (status == NODEST_YOU && primed < 1)
+    if (nodeStatus == NODEST_YOU && primed < 1)
 	primed += primeRate*0.001*time;
-    else if (status == NODEST_NONE && primed > 0)
+    else if (nodeStatus == NODEST_NONE && primed > 0)
 	primed = std::max(0.0, primed - 0.005*time);
 
-    if (status == NODEST_NONE || status == NODEST_YOU)
+    if (nodeStatus == NODEST_NONE || nodeStatus == NODEST_YOU)
     {
-	if (fabs(angleDiff(spin*3, 0)) < fabs(time*spinRate*3))
+	if (sounds && fabs(angleDiff(spin*3, 0)) < fabs(time*spinRate*3))
 	{
-	    soundEvents.newEvent(pos, nodeHumChunk,
+	    sounds->push(pos, SOUND_NODEHUM,
 		    48, pitch, true);
-	    if (status == NODEST_YOU)
+	    if (nodeStatus == NODEST_YOU)
 	    {
 		// harmonies
-		soundEvents.newEvent(pos, nodeHumChunk,
+		sounds->push(pos, SOUND_NODEHUM,
 			48, int(pitch*4/5), true);
-		soundEvents.newEvent(pos, nodeHumChunk,
+		sounds->push(pos, SOUND_NODEHUM,
 			48, int(pitch*2/3), true);
 	    }
 	}
@@ -73,14 +74,14 @@ void Node::doUpdate(int time)
 	if (primed >= 1)
 	{
 	    // c.f. Node::glowPhase()
-	    if (fabs(angleDiff(spin*6, 0)) < fabs(time*spinRate*6))
-		soundEvents.newEvent(pos, primedChunk, 48, pitch);
+	    if (sounds && fabs(angleDiff(spin*6, 0)) < fabs(time*spinRate*6))
+		sounds->push(pos, SOUND_PRIMED, 48, pitch);
 	}
 
 	spin += time*spinRate;
 	setPoints();
     }
-    else if (status == NODEST_EVIL)
+    else if (nodeStatus == NODEST_EVIL)
     {
 	// turn to point directly away from centre:
 	spin -= (angleDiff(0,spin*3)*time/3000);
@@ -98,9 +99,12 @@ int Node::extract(int time, bool hasCyan)
     {
 	extractionProgress--;
 	extracted++;
-	soundEvents.newEvent(pos, sparkChunk,
-		48 + int(16*gaussian()),
-		pitch + int(200*gaussian()));
+	// draw the randomness whether or not we're heard, so that the game
+	// goes the same either way
+	const int volume = 48 + int(16*rng->gaussian());
+	const int sparkPitch = pitch + int(200*rng->gaussian());
+	if (sounds)
+	    sounds->push(pos, SOUND_SPARK, volume, sparkPitch);
     }
 
     if (extracted)
@@ -111,20 +115,19 @@ int Node::extract(int time, bool hasCyan)
 
 void Node::setSparks()
 {
-    const int numSparkVertices = 3+rani(3);
-    sparkVertices.clear();
-    sparkPoint = rani(3);
+    numSparkVertices = 3+rng->rani(MAX_SPARK_VERTICES-2);
+    sparkPoint = rng->rani(3);
     RelPolarCoord vertex = RelPolarCoord(0, dist(points[0]));
-    sparkVertices.push_back(vertex);
+    sparkVertices[0] = vertex;
     for (int i = 1; i < numSparkVertices - 1; i++)
     {
 	vertex = RelPolarCoord(
-		vertex.angle + (-0.1+ranf(0.2))*i,
+		vertex.angle + (-0.1+rng->ranf(0.2))*i,
 		vertex.dist -
-		(0.5+ranf(0.5))*(vertex.dist/(numSparkVertices-i)));
-	sparkVertices.push_back(vertex);
+		(0.5+rng->ranf(0.5))*(vertex.dist/(numSparkVertices-i)));
+	sparkVertices[i] = vertex;
     }
-    sparkVertices.push_back(RelPolarCoord(0,0));
+    sparkVertices[numSparkVertices-1] = RelPolarCoord(0,0);
 }
 
 CartCoord Node::getSparkVertex(int v) const
@@ -167,20 +170,20 @@ Uint32 Node::colour() const
 
     int intensity = 0;
 
-    if (status == NODEST_NONE || status == NODEST_YOU)
+    if (nodeStatus == NODEST_NONE || nodeStatus == NODEST_YOU)
     {
 	if ( primed >= 1 ) 
 	    intensity = 0xff - (int)(0x30 * (1 - glowPhase().sinf()));
 	else
 	{
-	    intensity = (status == NODEST_NONE ? 0x80 : 0xbf);
+	    intensity = (nodeStatus == NODEST_NONE ? 0x80 : 0xbf);
 	    intensity += int( (0xff - intensity) *
 		    std::max(0.0, 1 - ( fabs(angleDiff(spin*3, 0)) * 2 )) );
 	}
     }
     else
-	intensity = status == NODEST_DESTROYED ? 0x20 :
-	    status == NODEST_EVIL ? 0xbf :
+	intensity = nodeStatus == NODEST_DESTROYED ? 0x20 :
+	    nodeStatus == NODEST_EVIL ? 0xbf :
 	    0x00;
     return col*0xff + intensity;
 }
@@ -229,7 +232,7 @@ void Node::draw(SDL_Surface* surface, const View& view, View*
 
     SpirallingPolygonalInvader::draw(surface, view, boundView, noAA);
 
-    if (status == NODEST_EVIL)
+    if (nodeStatus == NODEST_EVIL)
     {
 	static const float glintSep = ARENA_RAD/15.0;
 	float glintDist = pos.dist + glintSep*extractionProgress;
@@ -245,7 +248,7 @@ void Node::draw(SDL_Surface* surface, const View& view, View*
 	}
 	if (extractionProgress > 0.8)
 	{
-	    const int numVertices = sparkVertices.size();
+	    const int numVertices = numSparkVertices;
 	    const int sparkFrom = (int)(
 		    (extractionProgress-0.8)*numVertices/0.2);
 	    if (sparkFrom < numVertices - 1)
@@ -266,44 +269,66 @@ void Node::draw(SDL_Surface* surface, const View& view, View*
     }
 }
 
+void Node::setStatus(NodeStatus newStatus)
+{
+    if (newStatus == nodeStatus)
+	return;
+    if (ownership)
+	ownership->change(this, nodeStatus, newStatus);
+    nodeStatus = newStatus;
+}
+
+void NodeOwnership::change(Node* node, NodeStatus from, NodeStatus to)
+{
+    const Uint8 bit = 1 << node->nodeColour;
+    youMask &= ~bit;
+    evilMask &= ~bit;
+    if (to == NODEST_YOU)
+	youMask |= bit;
+    else if (to == NODEST_EVIL)
+	evilMask |= bit;
+
+    NodeEvent event = { node, from, to };
+    events.push_back(event);
+}
+
 bool Node::infest(InfestingInvader* inv)
 {
-    if (status == NODEST_DESTROYED || status == NODEST_EVIL)
+    if (nodeStatus == NODEST_DESTROYED || nodeStatus == NODEST_EVIL)
 	return false;
-    if (status == NODEST_YOU)
+    if (nodeStatus == NODEST_YOU)
     {
 	uncapture();
 	return false;
     }
-    status = NODEST_EVIL;
+    setStatus(NODEST_EVIL);
 
     return true;
 }
 void Node::uninfest()
 {
-    if (status == NODEST_EVIL)
-	status = NODEST_NONE;
+    if (nodeStatus == NODEST_EVIL)
+	setStatus(NODEST_NONE);
 }
 bool Node::capture(CapturePod* pod)
 {
-    if (status != NODEST_NONE)
+    if (nodeStatus != NODEST_NONE)
 	return false;
 
-    status = NODEST_YOU;
+    setStatus(NODEST_YOU);
     primeRate = pod->primeRate;
     return true;
 }
 void Node::uncapture()
 {
-    status = NODEST_NONE;
+    setStatus(NODEST_NONE);
 }
 
 int Node::hit(int weight)
 {
-    if (weight >= 3 && status == NODEST_YOU && primed >= 1)
+    if (weight >= 3 && nodeStatus == NODEST_YOU && primed >= 1)
     {
-	uncapture();
-	status = NODEST_DESTROYED;
+	setStatus(NODEST_DESTROYED);
 	primed = 0;
 	return 3;
     }
@@ -23,10 +23,48 @@ enum NodeColour
     NODEC_GREEN
 };
 
+class Node;
+class SoundQueue;
+
+// NodeEvent: a change in the status of a node
+struct NodeEvent
+{
+    Node* node;
+    NodeStatus from;
+    NodeStatus to;
+};
+
+// NodeOwnership: which node colours are held by you and by evil, as masks
+// with bit c set for NodeColour c. Node::setStatus keeps it up to date, and
+// appends each change to 'events' for anyone interested; the owner of the
+// nodes decides when to clear them.
+class NodeOwnership
+{
+    public:
+	Uint8 youMask;
+	Uint8 evilMask;
+
+	std::vector<NodeEvent> events;
+
+	bool youHave(NodeColour colour) const
+	{ return youMask & (1 << colour); }
+	bool evilHas(NodeColour colour) const
+	{ return evilMask & (1 << colour); }
+
+	void change(Node* node, NodeStatus from, NodeStatus to);
+
+	NodeOwnership() : youMask(0), evilMask(0) {}
+};
+
 class Node : public HPInvader, public SpirallingPolygonalInvader
 {
     private:
-	std::vector<RelPolarCoord> sparkVertices;
+	NodeStatus nodeStatus;
+	Random* rng;
+
+	static const int MAX_SPARK_VERTICES = 5;
+	RelPolarCoord sparkVertices[MAX_SPARK_VERTICES];
+	int numSparkVertices;
 	int sparkPoint;
 	void setSparks();
 	void setPoints();
@@ -44,7 +82,14 @@ class Node : public HPInvader, public SpirallingPolygonalInvader
 	Angle spin;
 
 	NodeColour nodeColour;
-	NodeStatus status;
+
+	// ownership: told of every status change, if non-NULL
+	NodeOwnership* ownership;
+	// sounds: where the node's sounds go; silent if NULL
+	SoundQueue* sounds;
+
+	NodeStatus status() const { return nodeStatus; }
+	void setStatus(NodeStatus newStatus);
 
 	float primed;
 	float primeRate;
@@ -67,7 +112,7 @@ class Node : public HPInvader, public SpirallingPolygonalInvader
 	void draw(SDL_Surface* surface, const View& view, View*
 		boundView=NULL, bool noAA=false) const;
 
-	Node(RelPolarCoord pos, float ds, NodeColour nodeColour,
+	Node(Random& rng, RelPolarCoord pos, float ds, NodeColour nodeColour,
 		float spinRate=0, Angle spin=0, int pitch=1000, float
 		radius=6);
 };
@@ -19,7 +19,7 @@
 #include "overlay.h"
 #include "geom.h"
 #include "data.h"
-#include "SDL_gfxPrimitivesDirty.h"
+#include "textcache.h"
 
 #include <string>
 #include <vector>
@@ -36,16 +36,30 @@ void Overlay::drawstr(SDL_Surface* surface, string str, Uint8 alpha)
 
 void Overlay::draw(SDL_Surface* surface, Uint8 alpha)
 {
-    if (!drawWithFont(surface, fontBig, 10, 20, alpha))
-	drawWithFont(surface, fontSmall, 7, 13, alpha, true);
+    // re-split only when the entries or the screen have changed
+    if (splitRad != screenGeom.rad ||
+	    static_cast<const vector<string>&>(*this) != splitFrom)
+    {
+	splitBig = split(10);
+	if (!splitBig)
+	    split(7, true);
+	splitFrom = *this;
+	splitRad = screenGeom.rad;
+    }
+
+    if (splitBig)
+	drawWithFont(surface, fontBig, 10, 20, alpha);
+    else
+	drawWithFont(surface, fontSmall, 7, 13, alpha);
 }
 
-bool Overlay::drawWithFont(SDL_Surface* surface, const void *fontdata, int cw,
-	int ch, Uint8 alpha, bool force)
+// split: join the entries into lines fitting in the overlay's width with
+// characters 'cw' wide; false if an entry doesn't fit, unless 'force'
+bool Overlay::split(int cw, bool force)
 {
     const unsigned int maxlen = (2*3*screenGeom.rad/5)/cw;
 
-    vector<string> splitStrings;
+    splitStrings.clear();
 
     for (vector<string>::iterator it = begin();
 	    it != end(); it++)
@@ -59,9 +73,12 @@ bool Overlay::drawWithFont(SDL_Surface* surface, const void *fontdata, int cw,
 	else
 	    splitStrings.push_back(*it);
     }
+    return true;
+}
 
-    gfxPrimitivesSetFont(fontdata, cw, ch);
-
+void Overlay::drawWithFont(SDL_Surface* surface, const void *fontdata, int cw,
+	int ch, Uint8 alpha)
+{
     const int ystart = screenGeom.centre.y + int(screenGeom.rad*offy) -
 	( splitStrings.size() * ch - ch/2 +
 	  (splitStrings.size() - 1) * ch/2 )/2;
@@ -74,9 +91,8 @@ bool Overlay::drawWithFont(SDL_Surface* surface, const void *fontdata, int cw,
     {
 	const int strx = screenGeom.centre.x - it->length()*cw/2;
 	const int stry = ystart + i*yinc;
-	stringColor(surface, strx, stry, it->c_str(),
+	textCache.draw(surface, strx, stry, *it, fontdata, cw, ch,
 		(alpha == 0) ? colour
 		    : (colour >> 8 << 8) + alpha);
     }
-    return true;
 }
@@ -9,8 +9,16 @@ using namespace std;
 class Overlay : public vector<string>
 {
     private:
-	bool drawWithFont(SDL_Surface* surface, const void* fontdata, int cw,
-		int ch, Uint8 alpha=0, bool force=false);
+	// the lines as last split to fit the screen, the entries and screen
+	// radius they were split for, and whether they fit in the big font
+	vector<string> splitStrings;
+	vector<string> splitFrom;
+	int splitRad;
+	bool splitBig;
+
+	bool split(int cw, bool force=false);
+	void drawWithFont(SDL_Surface* surface, const void* fontdata, int cw,
+		int ch, Uint8 alpha=0);
     public:
 	float offy; // y offset from centre, in screen radii
 	Uint32 colour;
@@ -20,8 +28,8 @@ class Overlay : public vector<string>
 	void drawstr(SDL_Surface* surface, string str, Uint8 alpha=0);
 
 	void draw(SDL_Surface* surface, Uint8 alpha=0);
-	Overlay(float offy=0, Uint32 colour=0xffffffff) : offy(offy),
-	    colour(colour) {}
+	Overlay(float offy=0, Uint32 colour=0xffffffff) : splitRad(0),
+	    splitBig(false), offy(offy), colour(colour) {}
 };
 
 #endif /* INC_OVERLAY_H */
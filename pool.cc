@@ -0,0 +1,201 @@
+/*
+ * Kuklomenos
+ * Copyright (C) 2008-2009 Martin Bays <mbays@sdf.lonestar.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+#include "pool.h"
+
+#ifdef DEBUG
+unsigned long heapAllocs = 0;
+
+// heapAllocsLock: guards heapAllocs; created by the first call to operator
+// new, which is made during static initialisation, before any thread starts
+static SDL_mutex* heapAllocsLock = NULL;
+
+// Replacements for the global allocation functions, counting allocations;
+// debug builds only.
+
+void* operator new(size_t size)
+{
+    if (!heapAllocsLock)
+	heapAllocsLock = SDL_CreateMutex();
+    SDL_mutexP(heapAllocsLock);
+    heapAllocs++;
+    SDL_mutexV(heapAllocsLock);
+
+    void* p = malloc(size ? size : 1);
+    if (!p)
+	throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+void operator delete[](void* p) throw()
+{
+    free(p);
+}
+#endif
+
+// slots are aligned suitably for any object we might put in them
+static const size_t SLOT_ALIGN = 16;
+
+// SlotHeader: precedes each object; 'pool' is the pool whose slot it is in,
+// or NULL if it was too big and went to the heap. Padded to SLOT_ALIGN so as
+// to keep the object aligned.
+union SlotHeader
+{
+    ObjectPool* pool;
+    char pad[SLOT_ALIGN];
+};
+
+ObjectPool::ObjectPool(size_t islotSize, int islotsPerChunk) :
+    slotSize(((islotSize + sizeof(SlotHeader) + SLOT_ALIGN-1) /
+		SLOT_ALIGN) * SLOT_ALIGN),
+    slotsPerChunk(islotsPerChunk), freeList(NULL),
+    live(0), highWater(0)
+{}
+
+ObjectPool::~ObjectPool()
+{
+    for (unsigned int i = 0; i < chunks.size(); i++)
+	::operator delete(chunks[i]);
+}
+
+void ObjectPool::grow()
+{
+    char* chunk = static_cast<char*>(::operator new(slotSize*slotsPerChunk));
+    chunks.push_back(chunk);
+    for (int i = slotsPerChunk-1; i >= 0; i--)
+    {
+	FreeSlot* slot = reinterpret_cast<FreeSlot*>(chunk + i*slotSize);
+	slot->next = freeList;
+	freeList = slot;
+    }
+}
+
+void* ObjectPool::alloc(size_t size)
+{
+    SlotHeader* header;
+    if (size + sizeof(SlotHeader) > slotSize)
+    {
+	header = static_cast<SlotHeader*>(
+		::operator new(size + sizeof(SlotHeader)));
+	header->pool = NULL;
+    }
+    else
+    {
+	if (!freeList)
+	    grow();
+	FreeSlot* slot = freeList;
+	freeList = slot->next;
+
+	if (++live > highWater)
+	    highWater = live;
+
+	header = reinterpret_cast<SlotHeader*>(slot);
+	header->pool = this;
+    }
+    return header + 1;
+}
+
+void ObjectPool::release(void* p)
+{
+    if (!p)
+	return;
+    SlotHeader* header = static_cast<SlotHeader*>(p) - 1;
+    ObjectPool* pool = header->pool;
+    if (!pool)
+    {
+	::operator delete(header);
+	return;
+    }
+
+    FreeSlot* slot = reinterpret_cast<FreeSlot*>(header);
+    slot->next = pool->freeList;
+    pool->freeList = slot;
+    pool->live--;
+}
+
+// statsLock: guards the statistics of every PoolClass, which arenas on
+// different threads add to as they are destroyed; created with the first
+// PoolClass, during static initialisation
+static SDL_mutex* statsLock = NULL;
+
+PoolClass::PoolClass(size_t isize, const char* iname) :
+    arenas(0), highWater(0), capacity(0),
+    size(isize), name(iname), index(registry().size())
+{
+    if (!statsLock)
+	statsLock = SDL_CreateMutex();
+    registry().push_back(this);
+}
+
+std::vector<PoolClass*>& PoolClass::registry()
+{
+    // function-local, so that it is constructed before any class which is
+    // defined at namespace scope registers itself
+    static std::vector<PoolClass*> classes;
+    return classes;
+}
+
+void PoolClass::printStats()
+{
+    std::vector<PoolClass*>& classes = registry();
+    for (std::vector<PoolClass*>::const_iterator it = classes.begin();
+	    it != classes.end();
+	    it++)
+    {
+	const PoolClass& c = **it;
+	printf("pool %s: high-water %d, capacity %d, over %d games\n",
+		c.name, c.highWater, c.capacity, c.arenas);
+    }
+}
+
+PoolArena::PoolArena()
+{
+    std::vector<PoolClass*>& classes = PoolClass::registry();
+    for (unsigned int i = 0; i < classes.size(); i++)
+	pools.push_back(new ObjectPool(classes[i]->size));
+}
+
+PoolArena::~PoolArena()
+{
+    std::vector<PoolClass*>& classes = PoolClass::registry();
+    SDL_mutexP(statsLock);
+    for (unsigned int i = 0; i < pools.size(); i++)
+    {
+	PoolClass& c = *classes[i];
+	c.arenas++;
+	c.highWater = std::max(c.highWater, pools[i]->highWater);
+	c.capacity = std::max(c.capacity, pools[i]->capacity());
+    }
+    SDL_mutexV(statsLock);
+
+    for (unsigned int i = 0; i < pools.size(); i++)
+	delete pools[i];
+}
@@ -0,0 +1,137 @@
+#ifndef INC_POOL_H
+#define INC_POOL_H
+
+#include <vector>
+#include <cstddef>
+#include <SDL/SDL.h>
+
+#ifdef DEBUG
+// heapAllocs: number of calls so far to the global operator new, by any
+// thread; compare before and after some code to see whether it allocates
+// with new. Only counted in debug builds ("make debug"), which replace the
+// global operator new; malloc and C libraries such as SDL aren't counted.
+extern unsigned long heapAllocs;
+#endif
+
+// ObjectPool: a free-list allocator handing out fixed-size slots. Memory is
+// taken from the heap in chunks of slots and returned when the pool is
+// destroyed; freed slots are kept for reuse, so once a pool has grown to its
+// high-water mark no further heap allocation is done. A pool is not locked:
+// it belongs to one PoolArena, used by one thread at a time.
+//
+// Each object is preceded by a header naming the pool it came from, so that
+// it can be freed knowing only its address.
+class ObjectPool
+{
+    private:
+	struct FreeSlot
+	{
+	    FreeSlot* next;
+	};
+
+	size_t slotSize;
+	int slotsPerChunk;
+	FreeSlot* freeList;
+	std::vector<char*> chunks;
+
+	void grow();
+
+	// no copying; the pool owns its chunks
+	ObjectPool(const ObjectPool&);
+	ObjectPool& operator=(const ObjectPool&);
+
+    public:
+	// live: slots currently allocated; highWater: max value live has had
+	int live;
+	int highWater;
+
+	int capacity() const { return chunks.size() * slotsPerChunk; }
+
+	// alloc: 'size' is the size of the object; objects too big for a slot
+	// (from a subclass of the pooled class) go to the heap instead
+	void* alloc(size_t size);
+	// release: free an object allocated by any pool's alloc
+	static void release(void* p);
+
+	ObjectPool(size_t islotSize, int islotsPerChunk=64);
+	~ObjectPool();
+};
+
+// PoolClass: a class which is allocated from pools. One is defined for each
+// pooled class, at namespace scope, which numbers the classes in order of
+// definition; see Pooled.
+class PoolClass
+{
+    private:
+	static std::vector<PoolClass*>& registry();
+
+	// over all arenas destroyed so far: the number of them, and the
+	// greatest high-water mark and capacity of their pools of this class
+	int arenas;
+	int highWater;
+	int capacity;
+
+	friend class PoolArena;
+
+    public:
+	const size_t size;
+	const char* const name;
+	const int index;
+
+	// count: number of pooled classes
+	static int count() { return registry().size(); }
+
+	// printStats: report the pool usage of every arena destroyed so far,
+	// by class, to stdout
+	static void printStats();
+
+	PoolClass(size_t isize, const char* iname);
+};
+
+// PoolArena: a pool for each pooled class, for the objects of one owner,
+// e.g. one game. The owner must be used by one thread at a time, and must
+// free every object allocated from its arena before destroying it; as the
+// arena is destroyed its pools' usage is added to that of their PoolClass.
+class PoolArena
+{
+    private:
+	std::vector<ObjectPool*> pools;
+
+	PoolArena(const PoolArena&);
+	PoolArena& operator=(const PoolArena&);
+
+    public:
+	ObjectPool& pool(const PoolClass& poolClass)
+	{ return *pools[poolClass.index]; }
+
+	PoolArena();
+	~PoolArena();
+};
+
+// Pooled: mixin giving a class T a class-specific placement operator new
+// drawing from the pool for T of a given PoolArena:
+//     T* t = new (arena) T(...);
+// and a matching operator delete, so that t is freed by 'delete t' as usual;
+// plain 'new T' doesn't compile. The PoolClass must be declared for each T
+// where T is declared, e.g.
+//     template<> const PoolClass Pooled<T>::poolClass;
+// and defined in one source file:
+//     template<> const PoolClass Pooled<T>::poolClass(sizeof(T), "T");
+//
+// Deleting through a pointer to a base works as expected provided the base
+// has a virtual destructor.
+template<class T> class Pooled
+{
+    public:
+	static const PoolClass poolClass;
+
+	static void* operator new(size_t size, PoolArena& arena)
+	{ return arena.pool(poolClass).alloc(size); }
+	// (called only if a constructor throws)
+	static void operator delete(void* p, PoolArena&)
+	{ ObjectPool::release(p); }
+	static void operator delete(void* p)
+	{ ObjectPool::release(p); }
+};
+
+#endif /* INC_POOL_H */
@@ -17,54 +17,88 @@
  */
 
 #include <cmath>
-#include <cstdlib>
+#include <ctime>
 
-float ranf()
+#include "random.h"
+
+static inline Uint32 rotl(Uint32 x, int k)
 {
-    return (float)(rand())/RAND_MAX;
+    return (x << k) | (x >> (32 - k));
 }
-float ranf(float m)
+
+Uint32 Random::next()
 {
-    return m*ranf();
+    const Uint32 result = rotl(s[1] * 5, 7) * 9;
+    const Uint32 t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+
+    return result;
+}
+
+// seed: fill the state from 'seed' with splitmix32, which never gives the
+// all-zero state
+void Random::seed(Uint32 seed)
+{
+    for (int i = 0; i < 4; i++)
+    {
+	Uint32 z = (seed += 0x9e3779b9);
+	z = (z ^ (z >> 16)) * 0x85ebca6b;
+	z = (z ^ (z >> 13)) * 0xc2b2ae35;
+	s[i] = z ^ (z >> 16);
+    }
+    haveSpare = false;
 }
 
-// rani(n) returns uniformly random integer in [0,n).
-int rani(int m)
+float Random::ranf()
+{
+    return (next() >> 8) * (1.0f/16777216);
+}
+float Random::ranf(float m)
 {
-    float r;
-    do
-    { r = ranf(); } while (r == 1);
+    return m*ranf();
+}
 
-    return (int)floorf(r*m);
+int Random::rani(int m)
+{
+    return (int)floor(next() * (1.0/4294967296.0) * m);
 }
 
 /* Returns a random number with distribution N(0,1). Uses Box-Muller. Code
  * taken from http://www.taygeta.com/random/gaussian.html.
  */
-float gaussian()
+float Random::gaussian()
 {
     float x1, x2, w, y;
-    static float spare_y = 1000;
 
     // the algorithm below returns two independent normally distributed
-    // numbers, so we store the spare one in a static variable for use on the
-    // subsequent call.
-    if (spare_y != 1000)
+    // numbers, so we store the spare one for use on the subsequent call.
+    if (haveSpare)
     {
-	float ret = spare_y;
-	spare_y = 1000;
-	return ret;
+	haveSpare = false;
+	return spareGaussian;
     }
 
     do {
 	x1 = 2.0 * ranf() - 1.0;
 	x2 = 2.0 * ranf() - 1.0;
 	w = x1 * x1 + x2 * x2;
-    } while ( w >= 1.0 );
+    } while ( w >= 1.0 || w == 0 );
 
     w = sqrt( (-2.0 * log( w ) ) / w );
     y = x1 * w;
-    spare_y = x2 * w;
+    spareGaussian = x2 * w;
+    haveSpare = true;
 
     return y;
 }
+
+Uint32 clockSeed()
+{
+    return time(NULL);
+}
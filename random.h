@@ -2,14 +2,44 @@
 #define INC_RANDOM_H
 
 #include <vector>
+#include <SDL/SDL.h>
 
-float ranf();
-float ranf(float m);
-int rani(int m);
-float gaussian();
+// Random: a pseudo-random number generator (xoshiro128**). Everything
+// which needs randomness has its own generator - each GameState, the
+// background, the main loop - so that a seed determines a game completely,
+// and games in different threads share no state.
+class Random
+{
+    private:
+	Uint32 s[4];
+	// spareGaussian: second result of the last Box-Muller draw, if
+	// haveSpare
+	float spareGaussian;
+	bool haveSpare;
+
+	Uint32 next();
+
+    public:
+	void seed(Uint32 seed);
+
+	// ranf(): uniformly random float in [0,1); ranf(m): in [0,m)
+	float ranf();
+	float ranf(float m);
+	// rani(n): uniformly random integer in [0,n)
+	int rani(int m);
+	// gaussian(): random number with distribution N(0,1)
+	float gaussian();
+
+	template<class T> std::vector<T> randomSort(std::vector<T> vec);
+
+	Random(Uint32 iseed=0) { seed(iseed); }
+};
+
+// clockSeed: a seed from the time, for when none is given
+Uint32 clockSeed();
 
 template<class T>
-std::vector<T> randomSort(std::vector<T> vec)
+std::vector<T> Random::randomSort(std::vector<T> vec)
 {
     std::vector<T> randomized;
 
@@ -0,0 +1,177 @@
+/*
+ * Kuklomenos
+ * Copyright (C) 2008-2009 Martin Bays <mbays@sdf.lonestar.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+
+#include "replay.h"
+#include "state.h"
+
+// File format, all little-endian:
+//	"KUKR", version byte
+//	seed (4 bytes), speed (1), rating (8, IEEE double), number of runs (4)
+//	per run: count (2), time (2), keys (1), flags (1),
+//	    turnRateFactor (4, IEEE float)
+static const char MAGIC[4] = { 'K', 'U', 'K', 'R' };
+static const Uint8 VERSION = 1;
+
+// runs are split at this length, to fit their 2-byte count
+static const int MAX_RUN = 0xffff;
+
+static void putBytes(FILE* f, unsigned long long v, int n)
+{
+    for (int i = 0; i < n; i++)
+	fputc((v >> (8*i)) & 0xff, f);
+}
+static bool getBytes(FILE* f, unsigned long long& v, int n)
+{
+    v = 0;
+    for (int i = 0; i < n; i++)
+    {
+	const int c = fgetc(f);
+	if (c == EOF)
+	    return false;
+	v |= (unsigned long long)(c) << (8*i);
+    }
+    return true;
+}
+
+Replay::Replay(Uint32 iseed, int ispeed, double irating) :
+    playRun(0), playCount(0), seed(iseed), speed(ispeed), rating(irating)
+{}
+
+void Replay::add(const ReplayStep& step)
+{
+    if (!runs.empty() && runs.back().step == step &&
+	    runs.back().count < MAX_RUN)
+	runs.back().count++;
+    else
+    {
+	Run run = { step, 1 };
+	runs.push_back(run);
+    }
+}
+
+int Replay::numSteps() const
+{
+    int n = 0;
+    for (unsigned int i = 0; i < runs.size(); i++)
+	n += runs[i].count;
+    return n;
+}
+
+void Replay::rewind()
+{
+    playRun = 0;
+    playCount = 0;
+}
+
+bool Replay::next(ReplayStep& step)
+{
+    if (playRun < runs.size() && playCount >= runs[playRun].count)
+    {
+	playRun++;
+	playCount = 0;
+    }
+    if (playRun >= runs.size())
+	return false;
+
+    step = runs[playRun].step;
+    playCount++;
+    return true;
+}
+
+bool Replay::save(const char* filename) const
+{
+    FILE* f = fopen(filename, "wb");
+    if (!f)
+	return false;
+
+    fwrite(MAGIC, 1, 4, f);
+    putBytes(f, VERSION, 1);
+    putBytes(f, seed, 4);
+    putBytes(f, speed, 1);
+    unsigned long long ratingBits;
+    memcpy(&ratingBits, &rating, 8);
+    putBytes(f, ratingBits, 8);
+    putBytes(f, runs.size(), 4);
+
+    for (unsigned int i = 0; i < runs.size(); i++)
+    {
+	const ReplayStep& step = runs[i].step;
+	Uint32 turnBits;
+	memcpy(&turnBits, &step.turnRateFactor, 4);
+	putBytes(f, runs[i].count, 2);
+	putBytes(f, step.time, 2);
+	putBytes(f, step.keys, 1);
+	putBytes(f, step.flags, 1);
+	putBytes(f, turnBits, 4);
+    }
+
+    return fclose(f) == 0;
+}
+
+bool Replay::load(const char* filename)
+{
+    FILE* f = fopen(filename, "rb");
+    if (!f)
+	return false;
+
+    char magic[4];
+    unsigned long long v, numRuns;
+    bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, MAGIC, 4) == 0 &&
+	getBytes(f, v, 1) && v == VERSION;
+    if (ok && (ok = getBytes(f, v, 4)))
+	seed = v;
+    if (ok && (ok = getBytes(f, v, 1)))
+	speed = v;
+    if (ok && (ok = getBytes(f, v, 8)))
+	memcpy(&rating, &v, 8);
+    // the speed indexes the config's ratings; a NaN or infinite rating
+    // fails the comparison too
+    ok = ok && speed >= 0 && speed <= 2 && rating >= 0 && rating <= DBL_MAX;
+    ok = ok && getBytes(f, numRuns, 4);
+
+    runs.clear();
+    for (unsigned long long i = 0; ok && i < numRuns; i++)
+    {
+	Run run;
+	Uint32 turnBits;
+	ok = getBytes(f, v, 2);
+	run.count = v;
+	ok = ok && getBytes(f, v, 2);
+	run.step.time = v;
+	ok = ok && getBytes(f, v, 1);
+	run.step.keys = v;
+	ok = ok && getBytes(f, v, 1);
+	run.step.flags = v;
+	ok = ok && getBytes(f, v, 4);
+	turnBits = v;
+	memcpy(&run.step.turnRateFactor, &turnBits, 4);
+	// an RF_END step's keys are the EndState, which indexes arrays
+	if ((run.step.flags & RF_END) && run.step.keys > END_WIN)
+	    ok = false;
+	if (ok)
+	    runs.push_back(run);
+    }
+
+    fclose(f);
+    rewind();
+    return ok;
+}
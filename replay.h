@@ -0,0 +1,69 @@
+#ifndef INC_REPLAY_H
+#define INC_REPLAY_H
+
+#include <vector>
+#include <SDL/SDL.h>
+
+// ReplayStep: the input to one call of GameState::update
+struct ReplayStep
+{
+    int time;
+    // keys: the keys held, as AI::keys; or for an RF_END step, the EndState
+    Uint8 keys;
+    Uint8 flags;
+    float turnRateFactor;
+
+    bool operator==(const ReplayStep& s) const
+    {
+	return time == s.time && keys == s.keys && flags == s.flags &&
+	    turnRateFactor == s.turnRateFactor;
+    }
+};
+
+// Replay: the input of a game - the seed and settings it started with, and
+// each step's time and keys - from which the game can be played again
+// exactly. Steps are held run-length encoded, since the input rarely changes
+// from one step to the next.
+class Replay
+{
+    private:
+	struct Run
+	{
+	    ReplayStep step;
+	    int count;
+	};
+	std::vector<Run> runs;
+
+	// position of playback: step playCount of run playRun
+	unsigned int playRun;
+	int playCount;
+
+    public:
+	// RF_INPUT: keys were applied this step
+	static const Uint8 RF_INPUT = 1<<0;
+	// RF_INVULN: invulnerability (a debug setting) was on
+	static const Uint8 RF_INVULN = 1<<1;
+	// RF_END: the game was ended from outside, e.g. by surrender
+	static const Uint8 RF_END = 1<<2;
+
+	Uint32 seed;
+	int speed;
+	double rating;
+
+	void add(const ReplayStep& step);
+	int numSteps() const;
+
+	// rewind, next: read the steps back in order; next returns false
+	// when there are none left
+	void rewind();
+	bool next(ReplayStep& step);
+
+	// save, load: to and from a compact binary file; return false on
+	// failure
+	bool save(const char* filename) const;
+	bool load(const char* filename);
+
+	Replay(Uint32 iseed=0, int ispeed=0, double irating=0);
+};
+
+#endif /* INC_REPLAY_H */
@@ -0,0 +1,314 @@
+/*
+ * Kuklomenos
+ * Copyright (C) 2008-2009 Martin Bays <mbays@sdf.lonestar.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+
+#include "selftest.h"
+#include "spiral.h"
+#include "invaders.h"
+#include "geom.h"
+#include "random.h"
+#include "coords.h"
+
+// Tolerances for the checks. The SSE2 and scalar spiral kernels differ only
+// in how they round the quarter turn, so agree to within float noise; the
+// batch and the per-object update differ in precision (float against
+// double), which accumulates over the steps taken.
+static const float SPIRAL_KERNEL_TOL = 1e-4;
+static const float SPIRAL_BATCH_TOL = 1e-2;
+// fastSinCos is good to a few float ulps of 1.
+static const float SINCOS_TOL = 1e-6;
+
+// points taken in [0,4) by checkSinCos
+static const int SINCOS_POINTS = 1 << 22;
+
+static const int SPIRAL_STEPS = 50;
+static const int SPIRAL_TIME = 20;
+
+// SpiralData: a SpiralBatch's arrays, for driving the kernels directly
+struct SpiralData
+{
+    std::vector<float> angle, dist, ds, dd, focusX, focusY;
+    std::vector<float> startX, startY, velX, velY;
+
+    SpiralData(int n) :
+	angle(n), dist(n), ds(n), dd(n), focusX(n), focusY(n),
+	startX(n), startY(n), velX(n), velY(n) {}
+
+    void step(bool scalar, int time)
+    {
+	(scalar ? spiralStepScalar : spiralStep)(angle.size(), time,
+		&angle[0], &dist[0], &ds[0], &dd[0], &focusX[0], &focusY[0],
+		&startX[0], &startY[0], &velX[0], &velY[0]);
+    }
+};
+
+// randomEggs: n eggs placed as GameState places them, with speeds up to
+// those of super eggs; 'approach' as for their dd.
+static void randomEggs(std::vector<EggInvader>& eggs, int n, Random& rng,
+	float approach)
+{
+    eggs.clear();
+    eggs.reserve(n);
+    for (int i = 0; i < n; i++)
+    {
+	eggs.push_back(EggInvader(RelPolarCoord(rng.ranf()*4,
+			ARENA_RAD/10 + rng.ranf(ARENA_RAD*9/10)),
+		    rng.rani(9)-4));
+	eggs.back().dd = approach;
+    }
+}
+
+// stepPerObject: update each egg alone, as GameState did before batching
+static void stepPerObject(std::vector<EggInvader>& eggs, int time)
+{
+    for (unsigned int i = 0; i < eggs.size(); i++)
+	eggs[i].update(time);
+}
+
+// stepBatch: update the eggs as GameState::updateSpirallers does
+static void stepBatch(std::vector<EggInvader>& eggs, SpiralBatch& batch,
+	int time)
+{
+    batch.clear();
+    for (unsigned int i = 0; i < eggs.size(); i++)
+	batch.add(eggs[i].pos.angle, eggs[i].pos.dist, eggs[i].ds,
+		eggs[i].dd, eggs[i].focus.x, eggs[i].focus.y);
+
+    batch.step(time);
+
+    for (int k = 0; k < batch.size(); k++)
+    {
+	eggs[k].pos.angle = batch.angle[k];
+	eggs[k].pos.dist = batch.dist[k];
+	eggs[k].setCollTrajectory(CartCoord(batch.startX[k], batch.startY[k]),
+		RelCartCoord(batch.velX[k], batch.velY[k]));
+    }
+}
+
+static bool report(const char* name, float err, float tol)
+{
+    const bool ok = err <= tol;
+    printf("%-40s max error %.3g (limit %.3g) %s\n", name, err, tol,
+	    ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// checkSinCos: fastSinCos against libm's sinf and cosf, over a whole turn
+static bool checkSinCos()
+{
+    float err = 0;
+    for (int i = 0; i < SINCOS_POINTS; i++)
+    {
+	const float a = i * (4.0f / SINCOS_POINTS);
+	float s, c;
+	fastSinCos(a, s, c);
+	err = std::max(err, fabsf(s - sinf(a * float(PI/2))));
+	err = std::max(err, fabsf(c - cosf(a * float(PI/2))));
+    }
+    return report("fastSinCos vs sinf/cosf", err, SINCOS_TOL);
+}
+
+// checkSpiralKernel: the SSE2 spiralStep against spiralStepScalar. n is
+// taken not a multiple of 4, so that spiralStep's scalar tail is run too.
+static bool checkSpiralKernel(Random& rng)
+{
+    const int n = 1003;
+    std::vector<EggInvader> eggs;
+    randomEggs(eggs, n, rng, 1);
+
+    SpiralData vec(n);
+    for (int i = 0; i < n; i++)
+    {
+	vec.angle[i] = eggs[i].pos.angle;
+	vec.dist[i] = eggs[i].pos.dist;
+	vec.ds[i] = eggs[i].ds;
+	vec.dd[i] = eggs[i].dd;
+	vec.focusX[i] = eggs[i].focus.x;
+	vec.focusY[i] = eggs[i].focus.y;
+    }
+    SpiralData scalar = vec;
+
+    float err = 0;
+    for (int t = 0; t < SPIRAL_STEPS; t++)
+    {
+	vec.step(false, SPIRAL_TIME);
+	scalar.step(true, SPIRAL_TIME);
+	for (int i = 0; i < n; i++)
+	{
+	    err = std::max(err, fabsf(vec.startX[i] - scalar.startX[i]));
+	    err = std::max(err, fabsf(vec.startY[i] - scalar.startY[i]));
+	    err = std::max(err, fabsf(vec.velX[i] - scalar.velX[i]));
+	    err = std::max(err, fabsf(vec.velY[i] - scalar.velY[i]));
+	    err = std::max(err, fabsf(vec.dist[i] - scalar.dist[i]));
+	}
+    }
+    return report("spiralStep vs spiralStepScalar", err,
+	    SPIRAL_KERNEL_TOL);
+}
+
+// checkSpiralBatch: SpiralBatch against SpirallingInvader::update
+static bool checkSpiralBatch(Random& rng)
+{
+    const int n = 1003;
+    std::vector<EggInvader> batched;
+    randomEggs(batched, n, rng, 1);
+    std::vector<EggInvader> single = batched;
+    SpiralBatch batch;
+
+    float err = 0;
+    for (int t = 0; t < SPIRAL_STEPS; t++)
+    {
+	stepBatch(batched, batch, SPIRAL_TIME);
+	stepPerObject(single, SPIRAL_TIME);
+	for (int i = 0; i < n; i++)
+	{
+	    const CollisionObject& b = batched[i].collObj();
+	    const CollisionObject& s = single[i].collObj();
+	    err = std::max(err, sqrtf((b.startPos - s.startPos).lengthsq()));
+	    err = std::max(err, sqrtf((b.velocity - s.velocity).lengthsq()));
+	    err = std::max(err,
+		    sqrtf((batched[i].cpos() - single[i].cpos()).lengthsq()));
+	}
+    }
+    return report("SpiralBatch vs SpirallingInvader::update", err,
+	    SPIRAL_BATCH_TOL);
+}
+
+int run_selftest()
+{
+    Random rng;
+    rng.seed(1);
+
+    int failed = 0;
+    failed += !checkSinCos();
+    failed += !checkSpiralKernel(rng);
+    failed += !checkSpiralBatch(rng);
+
+    printf("%d check%s failed\n", failed, failed == 1 ? "" : "s");
+    return failed;
+}
+
+// nsPer: nanoseconds per item, of 'items' items taking 'ticks' clock ticks
+static double nsPer(clock_t ticks, long items)
+{
+    return 1e9 * ticks / CLOCKS_PER_SEC / items;
+}
+
+// Each benchmark runs until this many items have been processed, so the
+// small sizes are not lost in clock()'s resolution.
+static const long BENCH_ITEMS = 20000000;
+
+// benchSpiral: per-object update, the batch as the game uses it, and the
+// kernel alone both vectorised and scalar, on n eggs. The eggs neither
+// approach nor recede, so that any number of steps can be taken.
+static void benchSpiral(int n, Random& rng)
+{
+    const long reps = BENCH_ITEMS / n;
+    std::vector<EggInvader> eggs;
+    randomEggs(eggs, n, rng, 0);
+    std::vector<EggInvader> batched = eggs;
+    SpiralBatch batch;
+    SpiralData data(n);
+    for (int i = 0; i < n; i++)
+    {
+	data.angle[i] = eggs[i].pos.angle;
+	data.dist[i] = eggs[i].pos.dist;
+	data.ds[i] = eggs[i].ds;
+	data.focusX[i] = eggs[i].focus.x;
+	data.focusY[i] = eggs[i].focus.y;
+    }
+    SpiralData scalar = data;
+
+    clock_t start = clock();
+    for (long r = 0; r < reps; r++)
+	stepPerObject(eggs, SPIRAL_TIME);
+    const double perObject = nsPer(clock() - start, reps*n);
+
+    start = clock();
+    for (long r = 0; r < reps; r++)
+	stepBatch(batched, batch, SPIRAL_TIME);
+    const double batchTime = nsPer(clock() - start, reps*n);
+
+    start = clock();
+    for (long r = 0; r < reps; r++)
+	data.step(false, SPIRAL_TIME);
+    const double kernel = nsPer(clock() - start, reps*n);
+
+    start = clock();
+    for (long r = 0; r < reps; r++)
+	scalar.step(true, SPIRAL_TIME);
+    const double kernelScalar = nsPer(clock() - start, reps*n);
+
+    printf("%6d  %10.1f %10.1f %10.1f %10.1f\n", n,
+	    perObject, batchTime, kernel, kernelScalar);
+}
+
+// benchSinCos: fastSinCos against sinf and cosf, on angles spread over a turn
+static void benchSinCos()
+{
+    const int n = 4096;
+    const long reps = BENCH_ITEMS / n;
+    std::vector<float> angles(n);
+    for (int i = 0; i < n; i++)
+	angles[i] = i * (4.0f / n);
+
+    // (the sums are printed, so that the calls can't be optimised away)
+    float fastSum = 0, libmSum = 0;
+    clock_t start = clock();
+    for (long r = 0; r < reps; r++)
+	for (int i = 0; i < n; i++)
+	{
+	    float s, c;
+	    fastSinCos(angles[i], s, c);
+	    fastSum += s + c;
+	}
+    const double fast = nsPer(clock() - start, reps*n);
+
+    start = clock();
+    for (long r = 0; r < reps; r++)
+	for (int i = 0; i < n; i++)
+	{
+	    const float x = angles[i] * float(PI/2);
+	    libmSum += sinf(x) + cosf(x);
+	}
+    const double libm = nsPer(clock() - start, reps*n);
+
+    printf("sin and cos, ns per angle:\n");
+    printf("%10s %10s\n", "fastSinCos", "sinf+cosf");
+    printf("%10.1f %10.1f\t(sums %g, %g)\n", fast, libm, fastSum, libmSum);
+}
+
+void run_bench()
+{
+    Random rng;
+    rng.seed(1);
+
+    printf("spiral update, ns per object:\n");
+    printf("%6s  %10s %10s %10s %10s\n", "n",
+	    "update", "batch", "spiralStep", "scalar");
+    const int sizes[] = { 100, 1000, 10000 };
+    for (int i = 0; i < 3; i++)
+	benchSpiral(sizes[i], rng);
+
+    benchSinCos();
+}
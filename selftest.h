@@ -0,0 +1,13 @@
+#ifndef INC_SELFTEST_H
+#define INC_SELFTEST_H
+
+// run_selftest: check each fast path against the code it stands in for,
+// printing the worst disagreement found; returns the number of checks which
+// failed.
+int run_selftest();
+
+// run_bench: time each fast path against the code it stands in for, printing
+// nanoseconds per item.
+void run_bench();
+
+#endif /* INC_SELFTEST_H */
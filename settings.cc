@@ -21,6 +21,7 @@
 #include "settings.h"
 #include "conffile.h"
 #include "keybindings.h"
+#include "random.h"
 #include "SDL_gfxPrimitivesDirty.h"
 #include <getopt.h>
 #include <SDL/SDL.h>
@@ -33,11 +34,13 @@ Settings::Settings() :
     useAA(AA_YES), showGrid(true), zoomEnabled(true), rotatingView(true),
     turnRateFactor(1.0), requestedRating(0), speed(0), stopMotion(false),
     keybindings(defaultKeybindings()), commandToBind(C_NONE), 
-    bgType(BG_NONE),
+    bgType(BG_NONE), bgCacheSize(2),
     fps(30), showFPS(true), width(0), height(0), bpp(16),
-    videoFlags(SDL_RESIZABLE | SDL_SWSURFACE), sound(true), volume(1.0),
+    videoFlags(SDL_RESIZABLE | SDL_SWSURFACE), partialUpdates(true),
+    sound(true), volume(1.0),
     soundFreq(44100),
-    clockRate(1000)
+    clockRate(1000), headlessGames(0), farmGames(0), farmThreads(0),
+    selftest(false), bench(false), seed(clockSeed())
 {
 }
 
@@ -69,6 +72,7 @@ void load_settings(int argc, char** argv)
 	    {"fps", 1, 0, 'f'},
 	    {"rating", 1, 0, 'r'},
 	    {"gamma", 1, 0, 'g' << 8},
+	    {"bgcache", 1, 0, 'c' << 8},
 	    {"noantialias", 0, 0, 'A'},
 	    {"nogrid", 0, 0, 'G'},
 	    {"nozoom", 0, 0, 'Z'},
@@ -82,6 +86,8 @@ void load_settings(int argc, char** argv)
 	    {"hwsurface", 0, 0, 's'},
 	    {"hwpalette", 0, 0, 'P'},
 	    {"noresizable", 0, 0, 'S'},
+	    {"partialupdates", 0, 0, 'u'},
+	    {"nopartialupdates", 0, 0, 'U'},
 	    {"nosound", 0, 0, 'q'},
 	    {"debug", 0, 0, 'd'},
 	    {"xyzzy", 0, 0, '+'},
@@ -89,11 +95,19 @@ void load_settings(int argc, char** argv)
 	    {"stopmotion", 0, 0, 'M'},
 	    {"speed", 1, 0, 'p'},
 	    {"aispeed", 1, 0, '-'},
+	    {"headless", 1, 0, 'h' << 8},
+	    {"farm", 1, 0, 'f' << 8},
+	    {"threads", 1, 0, 't' << 8},
+	    {"seed", 1, 0, 's' << 8},
+	    {"record", 1, 0, 'r' << 8},
+	    {"playback", 1, 0, 'p' << 8},
+	    {"selftest", 0, 0, 'T' << 8},
+	    {"bench", 0, 0, 'B' << 8},
 	    {"version", 0, 0, 'V'},
 	    {"help", 0, 0, 'h'},
 	    {0,0,0,0}
 	};
-	c = getopt_long(argc, argv, "W:H:b:f:r:t:I:p:AGZRagzFsPSqdiMVh",
+	c = getopt_long(argc, argv, "W:H:b:f:r:t:I:p:AGZRagzFsPSuUqdiMVh",
 		long_options, NULL);
 	if (c == -1)
 	    break;
@@ -135,6 +149,12 @@ void load_settings(int argc, char** argv)
 	    case 's':
 		settings.videoFlags |= SDL_HWSURFACE;
 		break;
+	    case 'u':
+		settings.partialUpdates = true;
+		break;
+	    case 'U':
+		settings.partialUpdates = false;
+		break;
 	    case 'Z':
 		settings.zoomEnabled = false;
 		break;
@@ -190,6 +210,55 @@ void load_settings(int argc, char** argv)
 		if (settings.speed < 0) settings.speed = 0;
 		if (settings.speed > 2) settings.speed = 2;
 		break;
+	    case 'h'<<8:
+		settings.headlessGames = atoi(optarg);
+		if (settings.headlessGames < 1)
+		{
+		    printf("bad number of games\n");
+		    exit(1);
+		}
+		settings.sound = false;
+		break;
+	    case 'c'<<8:
+		settings.bgCacheSize = atoi(optarg);
+		if (settings.bgCacheSize < 0)
+		{
+		    printf("bad number of backgrounds\n");
+		    exit(1);
+		}
+		break;
+	    case 'f'<<8:
+		settings.farmGames = atoi(optarg);
+		if (settings.farmGames < 1)
+		{
+		    printf("bad number of games\n");
+		    exit(1);
+		}
+		settings.sound = false;
+		break;
+	    case 't'<<8:
+		settings.farmThreads = atoi(optarg);
+		if (settings.farmThreads < 1)
+		{
+		    printf("bad number of threads\n");
+		    exit(1);
+		}
+		break;
+	    case 's'<<8:
+		settings.seed = strtoul(optarg, NULL, 0);
+		break;
+	    case 'r'<<8:
+		settings.recordFile = optarg;
+		break;
+	    case 'p'<<8:
+		settings.playbackFile = optarg;
+		break;
+	    case 'T'<<8:
+		settings.selftest = true;
+		break;
+	    case 'B'<<8:
+		settings.bench = true;
+		break;
 	    case 'V':
 		printf("%s\n", PACKAGE_STRING);
 		exit(0);
@@ -197,15 +266,27 @@ void load_settings(int argc, char** argv)
 		printf("Options:\n\t"
 			"-W --width WIDTH\n\t-H --height HEIGHT\n\t-b --bpp BITS\n\t-f --fps FPS\n\t"
 			"-F --fullscreen\n\t-S --noresizable\n\t-P --hwpalette\n\t-s --hwsurface\n\t"
+			"-U,-u --[no]partialupdates\n\t"
 			"-Z,-z --[no]zoom\n\t-R --[no]rotate\n\t-G,-g --[no]grid\n\t-A,-a --[no]antialias\n\t"
 			"-t --turnrate 0.1-1.0\n\t"
 			"-r --rating RATING\t\t1: harmless... 4: average... 9: elite\n\t"
 			"--gamma GAMMA\n\t"
+			"--bgcache N\t\t\tbackgrounds to keep drawn ahead\n\t"
 #ifdef SOUND
 			"-q --nosound\n\t"
 #endif
 			"-p --speed 0-2\n\n\t"
 			"-d --debug\n\t-i --invulnerable\t\timplies --debug\n\t-M --stopmotion\t\t\timplies --debug\n\n\t"
+			"--headless GAMES\t\tsimulate AI games without video\n\t"
+			"--farm GAMES\t\t\tsimulate AI games in parallel and"
+			" report statistics\n\t"
+			"--threads THREADS\t\tthreads for --farm\n\t"
+			"--seed SEED\t\t\tseed for random numbers\n\t"
+			"--record FILE\t\t\tsave input of each game to FILE\n\t"
+			"--playback FILE\t\t\treplay FILE; with --headless,"
+			" as fast as possible\n\t"
+			"--selftest\t\t\tcheck fast paths against reference code\n\t"
+			"--bench\t\t\t\ttime fast paths against reference code\n\n\t"
 			"-V --version\n\t-h --help\n");
 		exit(0);
 		break;
@@ -45,6 +45,9 @@ struct Settings
     command commandToBind;
 
     BGType bgType;
+    // bgCacheSize: number of backgrounds to keep drawn ahead, ready for
+    // restarts
+    int bgCacheSize;
 
     int fps;
     bool showFPS;
@@ -54,6 +57,9 @@ struct Settings
     int bpp;
     bool fullscreen;
     Uint32 videoFlags;
+    // partialUpdates: present only the changed parts of the screen each
+    // frame, rather than flipping the whole surface
+    bool partialUpdates;
 
     bool sound;
     float volume;
@@ -61,6 +67,31 @@ struct Settings
 
     int clockRate;
 
+    // headlessGames: if positive, simulate this many AI games without
+    // video or sound, as fast as possible, and print the results
+    int headlessGames;
+
+    // farmGames: if positive, simulate this many AI games as with
+    // headlessGames, but spread over farmThreads threads (0 meaning one per
+    // processor), and print only statistics of the results
+    int farmGames;
+    int farmThreads;
+
+    // selftest: check the fast paths against the code they replace, and
+    // exit; bench: time them against it, and exit
+    bool selftest;
+    bool bench;
+
+    // seed: seed for the first game, with later games using seed+1,
+    // seed+2, ...; taken from the clock unless given
+    Uint32 seed;
+
+    // recordFile: if non-empty, save the input of each game here as it
+    // ends, for replaying; playbackFile: if non-empty, replay this file
+    // rather than play
+    string recordFile;
+    string playbackFile;
+
     Settings();
 };
 
@@ -22,24 +22,16 @@
 
 #include "sound.h"
 
-Mix_Chunk* invDieChunk = NULL;
-Mix_Chunk* invHitChunk = NULL;
-Mix_Chunk* sparkChunk = NULL;
-Mix_Chunk* shotChunk = NULL;
-Mix_Chunk* shieldChunk = NULL;
-Mix_Chunk* primedChunk = NULL;
-Mix_Chunk* nodeHumChunk = NULL;
-Mix_Chunk* mutChunk = NULL;
-
 SoundEvents soundEvents;
 
 
 #ifndef SOUND
-void SoundEvents::newEvent(RelPolarCoord pos, Mix_Chunk* chunk,
-	int volume, int stretch, bool noSight)
-{} 
-void SoundEvents::update(RelPolarCoord aimPos)
-{}
+void SoundEvents::play(SoundQueue& queue, RelPolarCoord aimPos)
+{
+    SoundTrigger trigger;
+    while (queue.pop(trigger))
+	;
+}
 #else
 
 #include "SDL_mixer/SDL_mixer.h"
@@ -50,6 +42,9 @@ void SoundEvents::update(RelPolarCoord aimPos)
 #include "random.h"
 #include "settings.h"
 
+// soundChunks: the sample for each Sound, once audio is initialised
+static Mix_Chunk* soundChunks[NUM_SOUNDS];
+
 void channelDone(int channel)
 {
     soundEvents.channelDone(channel);
@@ -132,11 +127,15 @@ void SoundEvents::update(RelPolarCoord aimPos)
 	    end());
 }
 
-void SoundEvents::newEvent(RelPolarCoord pos, Mix_Chunk* chunk,
-	int volume, int stretch, bool noSight)
+void SoundEvents::play(SoundQueue& queue, RelPolarCoord aimPos)
 {
-    if (settings.sound && ( audioInitialised || initialiseAudio() ))
-	push_back(SoundEvent(pos, chunk, volume, stretch, noSight));
+    SoundTrigger trigger;
+    while (queue.pop(trigger))
+	if (settings.sound && ( audioInitialised || initialiseAudio() ))
+	    push_back(SoundEvent(trigger.pos, soundChunks[trigger.sound],
+			trigger.volume, trigger.stretch, trigger.noSight));
+
+    update(aimPos);
 }
 
 void SoundEvents::channelDone(int channel)
@@ -160,17 +159,22 @@ bool SoundEvents::initialiseAudio()
     printf("Opened audio at %d Hz %d bit %s, %d bytes audio buffer\n", audio_rate,
 	    bits, audio_channels>1?"stereo":"mono", audio_buffers );
 
-    invDieChunk = Mix_LoadWAV(findDataPath("sounds/invdie.ogg").c_str());
-    invHitChunk = Mix_LoadWAV(findDataPath("sounds/invhit.ogg").c_str());
-    sparkChunk = Mix_LoadWAV(findDataPath("sounds/spark.ogg").c_str());
-    primedChunk = Mix_LoadWAV(findDataPath("sounds/primed.ogg").c_str());
-    shieldChunk = Mix_LoadWAV(findDataPath("sounds/shield.ogg").c_str());
-    shotChunk = Mix_LoadWAV(findDataPath("sounds/shot.ogg").c_str());
-    nodeHumChunk = Mix_LoadWAV(findDataPath("sounds/hum.ogg").c_str());
-    mutChunk = Mix_LoadWAV(findDataPath("sounds/mutilation.ogg").c_str());
-
-    if (!shotChunk)
-	printf("Failed to open sound file 'sounds/shot.ogg'\n");
+    static const char* const soundFiles[NUM_SOUNDS] = {
+	"sounds/invdie.ogg",
+	"sounds/invhit.ogg",
+	"sounds/spark.ogg",
+	"sounds/shot.ogg",
+	"sounds/shield.ogg",
+	"sounds/primed.ogg",
+	"sounds/hum.ogg",
+	"sounds/mutilation.ogg"
+    };
+    for (int i = 0; i < NUM_SOUNDS; i++)
+    {
+	soundChunks[i] = Mix_LoadWAV(findDataPath(soundFiles[i]).c_str());
+	if (!soundChunks[i])
+	    printf("Failed to open sound file '%s'\n", soundFiles[i]);
+    }
 
     Mix_AllocateChannels(32);
 
@@ -3,9 +3,82 @@
 
 #include "coords.h"
 #include <vector>
+#include <SDL/SDL.h>
 
 struct Mix_Chunk;
 
+// Sound: the samples a game can play
+enum Sound
+{
+    SOUND_INVDIE,
+    SOUND_INVHIT,
+    SOUND_SPARK,
+    SOUND_SHOT,
+    SOUND_SHIELD,
+    SOUND_PRIMED,
+    SOUND_NODEHUM,
+    SOUND_MUT,
+    NUM_SOUNDS
+};
+
+// SoundTrigger: a request by a game to play a sound; 'stretch' is the
+// playback rate in thousandths
+struct SoundTrigger
+{
+    RelPolarCoord pos;
+    Sint16 volume;
+    Sint16 stretch;
+    Uint8 sound;
+    bool noSight;
+};
+
+// SoundQueue: the sounds a game has triggered and which have yet to be
+// played, in a ring buffer. The game is the only writer, advancing 'head',
+// and the audio stage the only reader, advancing 'tail', so no lock is
+// needed; both run in the main loop, so no memory fences are either.
+// Triggers are dropped if the queue is full, or if it isn't enabled, as
+// for a game nobody will hear.
+class SoundQueue
+{
+    public:
+	static const unsigned int SIZE = 256;
+
+    private:
+	SoundTrigger ring[SIZE];
+	unsigned int head;
+	unsigned int tail;
+
+    public:
+	bool enabled;
+
+	void push(RelPolarCoord pos, Sound sound,
+		int volume=128, int stretch=1000, bool noSight=false)
+	{
+	    if (!enabled || head - tail == SIZE)
+		return;
+	    SoundTrigger& trigger = ring[head % SIZE];
+	    trigger.pos = pos;
+	    trigger.volume = volume;
+	    trigger.stretch = stretch;
+	    trigger.sound = sound;
+	    trigger.noSight = noSight;
+	    head++;
+	}
+
+	// pop: take the oldest trigger; false if there are none
+	bool pop(SoundTrigger& trigger)
+	{
+	    if (tail == head)
+		return false;
+	    trigger = ring[tail % SIZE];
+	    tail++;
+	    return true;
+	}
+
+	SoundQueue(bool ienabled=false) :
+	    head(0), tail(0), enabled(ienabled) {}
+};
+
 class SoundEvent
 {
     private:
@@ -29,28 +102,24 @@ class SoundEvent
 		int volume=128, int stretch=1000, bool noSight=false);
 };
 
+// SoundEvents: the audio stage - the sounds playing, fed from a game's
+// SoundQueue once a frame
 class SoundEvents : public std::vector<SoundEvent>
 {
     private:
 	bool audioInitialised;
 	bool initialiseAudio();
-    public:
 	void update(RelPolarCoord aimPos);
-	void newEvent(RelPolarCoord pos, Mix_Chunk* chunk,
-		int volume=128, int stretch=1000, bool noSight=false);
+    public:
+	// play: start the sounds in 'queue', emptying it, and adjust those
+	// playing to where the player is looking from, 'aimPos'. Whether to
+	// start them is decided here, by settings.sound, so that turning
+	// sound on or off takes effect at once
+	void play(SoundQueue& queue, RelPolarCoord aimPos);
 	void channelDone(int channel);
 	SoundEvents() : audioInitialised(false) {}
 };
 
 extern SoundEvents soundEvents;
 
-extern Mix_Chunk* invDieChunk;
-extern Mix_Chunk* invHitChunk;
-extern Mix_Chunk* sparkChunk;
-extern Mix_Chunk* shotChunk;
-extern Mix_Chunk* shieldChunk;
-extern Mix_Chunk* primedChunk;
-extern Mix_Chunk* nodeHumChunk;
-extern Mix_Chunk* mutChunk;
-
 #endif /* INC_SOUND_H */
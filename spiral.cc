@@ -0,0 +1,189 @@
+/*
+ * Kuklomenos
+ * Copyright (C) 2008-2009 Martin Bays <mbays@sdf.lonestar.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "spiral.h"
+#include "coords.h"
+
+// spiralStep1: spiralStep for object i alone
+static inline void spiralStep1(int i, int time, float* angle, float* dist,
+	const float* ds, const float* dd,
+	const float* focusX, const float* focusY,
+	float* startX, float* startY, float* velX, float* velY)
+{
+    float s, c;
+    const float a0 = angle[i];
+    const float d0 = dist[i];
+    fastSinCos(a0, s, c);
+    const float x0 = focusX[i] - d0*s;
+    const float y0 = focusY[i] + d0*c;
+
+    float a1 = a0 + ds[i]*(0.01f*time)/d0;
+    a1 -= 4*floorf(a1*0.25f);
+    const float d1 = d0 + dd[i]*(-0.0075f*time);
+    fastSinCos(a1, s, c);
+
+    const float invTime = 1.0f/time;
+    angle[i] = a1;
+    dist[i] = d1;
+    startX[i] = x0;
+    startY[i] = y0;
+    velX[i] = (focusX[i] - d1*s - x0)*invTime;
+    velY[i] = (focusY[i] + d1*c - y0)*invTime;
+}
+
+#ifdef __SSE2__
+// sinCos4: fastSinCos on four angles at once
+static inline void sinCos4(__m128 a, __m128& s, __m128& c)
+{
+    const __m128i q = _mm_cvtps_epi32(a);
+    const __m128 x = _mm_mul_ps(_mm_sub_ps(a, _mm_cvtepi32_ps(q)),
+	    _mm_set1_ps(PI/2));
+    const __m128 x2 = _mm_mul_ps(x, x);
+
+    __m128 ps = _mm_add_ps(_mm_set1_ps(SINCOS_S5),
+	    _mm_mul_ps(x2, _mm_set1_ps(SINCOS_S7)));
+    ps = _mm_add_ps(_mm_set1_ps(SINCOS_S3), _mm_mul_ps(x2, ps));
+    ps = _mm_add_ps(_mm_set1_ps(1), _mm_mul_ps(x2, ps));
+    ps = _mm_mul_ps(x, ps);
+
+    __m128 pc = _mm_add_ps(_mm_set1_ps(SINCOS_C6),
+	    _mm_mul_ps(x2, _mm_set1_ps(SINCOS_C8)));
+    pc = _mm_add_ps(_mm_set1_ps(SINCOS_C4), _mm_mul_ps(x2, pc));
+    pc = _mm_add_ps(_mm_set1_ps(SINCOS_C2), _mm_mul_ps(x2, pc));
+    pc = _mm_add_ps(_mm_set1_ps(1), _mm_mul_ps(x2, pc));
+
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128 swap = _mm_castsi128_ps(
+	    _mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    const __m128 sSign = _mm_castsi128_ps(
+	    _mm_slli_epi32(_mm_and_si128(q, two), 30));
+    const __m128 cSign = _mm_castsi128_ps(
+	    _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+
+    s = _mm_xor_ps(sSign,
+	    _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps)));
+    c = _mm_xor_ps(cSign,
+	    _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc)));
+}
+
+// floor4: floor of four floats, which must be within the range of an int
+static inline __m128 floor4(__m128 v)
+{
+    const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1)));
+}
+#endif
+
+void spiralStep(int n, int time, float* angle, float* dist,
+	const float* ds, const float* dd,
+	const float* focusX, const float* focusY,
+	float* startX, float* startY, float* velX, float* velY)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128 angleRate = _mm_set1_ps(0.01f*time);
+    const __m128 distRate = _mm_set1_ps(-0.0075f*time);
+    const __m128 invTime = _mm_set1_ps(1.0f/time);
+    for (; i + 4 <= n; i += 4)
+    {
+	__m128 s, c;
+	const __m128 a0 = _mm_loadu_ps(angle + i);
+	const __m128 d0 = _mm_loadu_ps(dist + i);
+	const __m128 fx = _mm_loadu_ps(focusX + i);
+	const __m128 fy = _mm_loadu_ps(focusY + i);
+
+	sinCos4(a0, s, c);
+	const __m128 x0 = _mm_sub_ps(fx, _mm_mul_ps(d0, s));
+	const __m128 y0 = _mm_add_ps(fy, _mm_mul_ps(d0, c));
+
+	__m128 a1 = _mm_add_ps(a0, _mm_div_ps(
+		    _mm_mul_ps(_mm_loadu_ps(ds + i), angleRate), d0));
+	a1 = _mm_sub_ps(a1, _mm_mul_ps(_mm_set1_ps(4),
+		    floor4(_mm_mul_ps(a1, _mm_set1_ps(0.25f)))));
+	const __m128 d1 = _mm_add_ps(d0,
+		_mm_mul_ps(_mm_loadu_ps(dd + i), distRate));
+	sinCos4(a1, s, c);
+
+	const __m128 x1 = _mm_sub_ps(fx, _mm_mul_ps(d1, s));
+	const __m128 y1 = _mm_add_ps(fy, _mm_mul_ps(d1, c));
+
+	_mm_storeu_ps(angle + i, a1);
+	_mm_storeu_ps(dist + i, d1);
+	_mm_storeu_ps(startX + i, x0);
+	_mm_storeu_ps(startY + i, y0);
+	_mm_storeu_ps(velX + i, _mm_mul_ps(_mm_sub_ps(x1, x0), invTime));
+	_mm_storeu_ps(velY + i, _mm_mul_ps(_mm_sub_ps(y1, y0), invTime));
+    }
+#endif
+
+    for (; i < n; i++)
+	spiralStep1(i, time, angle, dist, ds, dd, focusX, focusY,
+		startX, startY, velX, velY);
+}
+
+void spiralStepScalar(int n, int time, float* angle, float* dist,
+	const float* ds, const float* dd,
+	const float* focusX, const float* focusY,
+	float* startX, float* startY, float* velX, float* velY)
+{
+    for (int i = 0; i < n; i++)
+	spiralStep1(i, time, angle, dist, ds, dd, focusX, focusY,
+		startX, startY, velX, velY);
+}
+
+void SpiralBatch::clear()
+{
+    angle.clear();
+    dist.clear();
+    ds.clear();
+    dd.clear();
+    focusX.clear();
+    focusY.clear();
+}
+
+void SpiralBatch::add(float iangle, float idist, float ids, float idd,
+	float ifocusX, float ifocusY)
+{
+    angle.push_back(iangle);
+    dist.push_back(idist);
+    ds.push_back(ids);
+    dd.push_back(idd);
+    focusX.push_back(ifocusX);
+    focusY.push_back(ifocusY);
+}
+
+void SpiralBatch::step(int time)
+{
+    const int n = size();
+    startX.resize(n);
+    startY.resize(n);
+    velX.resize(n);
+    velY.resize(n);
+    if (n == 0)
+	return;
+    spiralStep(n, time, &angle[0], &dist[0], &ds[0], &dd[0],
+	    &focusX[0], &focusY[0],
+	    &startX[0], &startY[0], &velX[0], &velY[0]);
+}
@@ -0,0 +1,53 @@
+#ifndef INC_SPIRAL_H
+#define INC_SPIRAL_H
+
+#include <vector>
+
+// SpiralBatch: the motion of a set of spiralling objects, held as parallel
+// arrays so that a step can be integrated for all of them in one pass.
+// Entry i of each array describes the i'th object added.
+//
+// angle, dist, ds, dd and focusX/Y are as for SpirallingInvader; step()
+// advances angle and dist, and sets startX/Y to each object's absolute
+// position before the step and velX/Y to its velocity over it.
+class SpiralBatch
+{
+    public:
+	std::vector<float> angle;
+	std::vector<float> dist;
+	std::vector<float> ds;
+	std::vector<float> dd;
+	std::vector<float> focusX;
+	std::vector<float> focusY;
+
+	std::vector<float> startX;
+	std::vector<float> startY;
+	std::vector<float> velX;
+	std::vector<float> velY;
+
+	int size() const { return angle.size(); }
+
+	// clear: empty the batch, keeping the arrays' storage
+	void clear();
+	void add(float iangle, float idist, float ids, float idd,
+		float ifocusX, float ifocusY);
+
+	void step(int time);
+};
+
+// spiralStep: the kernel behind SpiralBatch::step, on raw arrays of n
+// objects. Uses SSE2 where available, with a scalar loop computing the same
+// thing for the remainder and on other machines.
+void spiralStep(int n, int time, float* angle, float* dist,
+	const float* ds, const float* dd,
+	const float* focusX, const float* focusY,
+	float* startX, float* startY, float* velX, float* velY);
+
+// spiralStepScalar: spiralStep using only the scalar loop, for checking the
+// SSE2 path against
+void spiralStepScalar(int n, int time, float* angle, float* dist,
+	const float* ds, const float* dd,
+	const float* focusX, const float* focusY,
+	float* startX, float* startY, float* velX, float* velY);
+
+#endif /* INC_SPIRAL_H */
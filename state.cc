@@ -43,13 +43,17 @@ const int* scales[3] = { pentatonicScale, majorScale, minorScale };
 // beatRatios: beat frequency of inner is beatRatio * frequency of outer
 const float beatRatios[5] = { 1.0/1.0, 3.0/2.0, 4.0/3.0, 5.0/4.0, 5.0/3.0 };
 
-GameState::GameState(int speed) :
+GameState::GameState(int speed, Uint32 seed, double requestedRating) :
     targettedNode(NULL), mutilationWave(-1), preMutilationPhase(0),
     extractPreMutCutoff(350), freeViewMode(false),
     extracted(0), extractDecayRate(0.0002), you(), zoomdist(0), invaderRate(0),
-    speed(speed), extractMax(500), end(END_NOT), ai(NULL)
+    speed(speed), extractMax(500), end(END_NOT), ai(NULL),
+    seed(seed), rng(seed), drawRng(~seed), collisionTests(0),
+    invuln(settings.invuln), turnRateFactor(settings.turnRateFactor),
+    recording(NULL),
+    sounds(settings.headlessGames == 0 && settings.farmGames == 0)
 {
-    setRating();
+    setRating(requestedRating);
     invaderCooldown = invaderRate;
 
     std::vector<NodeColour> colours;
@@ -62,16 +66,16 @@ GameState::GameState(int speed) :
     if (this->rating > 5.0)
     {
 	// Let's mix things up a bit...
-	colours = randomSort(colours);
-	baseAngleInner = ranf(4.0);
-	baseAngleOuter = ranf(4.0);
-	if (rani(2) == 0)
+	colours = rng.randomSort(colours);
+	baseAngleInner = rng.ranf(4.0);
+	baseAngleOuter = rng.ranf(4.0);
+	if (rng.rani(2) == 0)
 	    innerDir = -1;
     }
 
-    const int* scale = scales[rani(3)];
-    const int key = rani(12) - 8;
-    const float beatRatio = beatRatios[rani(5)];
+    const int* scale = scales[rng.rani(3)];
+    const int key = rng.rani(12) - 8;
+    const float beatRatio = beatRatios[rng.rani(5)];
 
     set<int> notesUsed;
 
@@ -82,43 +86,37 @@ GameState::GameState(int speed) :
     {
 	const NodeColour colour = *it;
 
-	int note = rani(14);
+	int note = rng.rani(14);
 	while (notesUsed.find(note) != notesUsed.end())
-	    note = rani(14);
+	    note = rng.rani(14);
 	notesUsed.insert(note);
 
 	const int pitch = int(1000 *
 		pow(2, - (key+scale[note]) / 12.0) );
 	if (i < 3)
 	    nodes.push_back(
-		    Node(RelPolarCoord(baseAngleInner+2+i*4.0/3,
+		    Node(rng, RelPolarCoord(baseAngleInner+2+i*4.0/3,
 			    ARENA_RAD * 5/9),
 			innerDir*1.0, colour,
-			beatRatio*1.0/3000, rani(16)/4.0, pitch));
+			beatRatio*1.0/3000, rng.rani(16)/4.0, pitch));
 	else
 	    nodes.push_back(
-		    Node(RelPolarCoord(baseAngleOuter+i*4.0/3,
+		    Node(rng, RelPolarCoord(baseAngleOuter+i*4.0/3,
 			    ARENA_RAD * 2/3),
 			-innerDir*1.0, colour,
-			1.0/3000, rani(16)/4.0, pitch));
+			1.0/3000, rng.rani(16)/4.0, pitch));
     }
-}
-
-bool isNullInvp(Invader* p)
-{
-    return (p == NULL);
-}
 
-bool GameState::youHaveNode(NodeColour colour)
-{
     for (std::vector<Node>::iterator it = nodes.begin();
 	    it != nodes.end();
 	    it++)
-	if (it->status == NODEST_YOU && it->nodeColour == colour)
-	    return true;
-    return false;
+    {
+	it->ownership = &nodeOwnership;
+	it->sounds = &sounds;
+    }
 }
-bool GameState::youHaveShotNode(int type)
+
+bool GameState::youHaveShotNode(int type) const
 {
     switch (type)
     {
@@ -129,15 +127,6 @@ bool GameState::youHaveShotNode(int type)
 	default: return false;
     }
 }
-bool GameState::evilHasNode(NodeColour colour)
-{
-    for (std::vector<Node>::iterator it = nodes.begin();
-	    it != nodes.end();
-	    it++)
-	if (it->status == NODEST_EVIL && it->nodeColour == colour)
-	    return true;
-    return false;
-}
 
 int GameState::shotHeat(int type)
 {
@@ -183,32 +172,31 @@ void GameState::updateMutilation(int time)
 		it != nodes.end();
 		it++)
 	    if (it->pos.dist >= mutilationWave-it->radius)
-		if (it->status != NODEST_NONE &&
-			it->status != NODEST_DESTROYED)
+		if (it->status() != NODEST_NONE &&
+			it->status() != NODEST_DESTROYED)
 		{
-		    it->status = NODEST_NONE;
+		    it->setStatus(NODEST_NONE);
 
-		    soundEvents.newEvent(it->cpos() - ARENA_CENTRE,
-			    mutChunk, 128, it->pitch,
+		    sounds.push(it->cpos() - ARENA_CENTRE,
+			    SOUND_MUT, 128, it->pitch,
 			    true);
 		}
 
-	for (std::vector<Invader*>::iterator it = invaders.begin();
-		it != invaders.end();
-		it++)
-	    if (((*it)->cpos() - ARENA_CENTRE).lengthsq() >=
+	for (unsigned int i = 0; i < invaders.size(); i++)
+	    if ((invaders.pos[i] - ARENA_CENTRE).lengthsq() >=
 		    mutilationWave*mutilationWave)
 	    {
-		int damage = (*it)->die();
-		if ((*it)->dead())
+		Invader* inv = invaders[i];
+		int damage = inv->die();
+		if (inv->dead())
 		{
-		    soundEvents.newEvent((*it)->cpos() - ARENA_CENTRE,
-			    invDieChunk,
-			    128, 500+100*damage + int(200*gaussian()),
+		    sounds.push(invaders.pos[i] - ARENA_CENTRE,
+			    SOUND_INVDIE,
+			    128, 500+100*damage + int(200*rng.gaussian()),
 			    true);
-		    soundEvents.newEvent((*it)->cpos() - ARENA_CENTRE,
-			    mutChunk,
-			    128, 500+100*damage + int(200*gaussian()),
+		    sounds.push(invaders.pos[i] - ARENA_CENTRE,
+			    SOUND_MUT,
+			    128, 500+100*damage + int(200*rng.gaussian()),
 			    true);
 		}
 	    }
@@ -225,17 +213,17 @@ void GameState::updateMutilation(int time)
 
 	while (!you.dead && mutilationWave <= you.radius())
 	{
-	    soundEvents.newEvent(0, shieldChunk,
+	    sounds.push(0, SOUND_SHIELD,
 		    128, 1000 + 100*int(you.shield)); 
 	    you.shield -= 1;
 	    if (you.shield < 0)
 	    {
 		you.dead = true;
-		soundEvents.newEvent(0, mutChunk,
+		sounds.push(0, SOUND_MUT,
 			128, 2000); 
 	    }
 	    else
-		soundEvents.newEvent(0, mutChunk,
+		sounds.push(0, SOUND_MUT,
 			128, 1000 + 100*int(you.shield)); 
 	    end = END_EXTRACTED;
 	}
@@ -247,7 +235,7 @@ void GameState::updateMutilation(int time)
 	{
 	    float stage = float(extracted - extractPreMutCutoff) /
 		(extractMax - extractPreMutCutoff );
-	    soundEvents.newEvent(0, mutChunk,
+	    sounds.push(0, SOUND_MUT,
 		    int(24 + 48 * stage),
 		    int(1400 - 400 * stage));
 	}
@@ -259,32 +247,106 @@ void GameState::update(int time, bool noInput)
     if (time <= 0)
 	return;
 
-    deadShots = false;
-
     if (ai)
 	ai->update(time);
 
+    const bool input = !noInput || ai;
+    const Uint8 keys = !input ? 0 : ai ? ai->keys : keyboardKeys();
+    invuln = settings.invuln;
+    turnRateFactor = settings.turnRateFactor;
+
+    if (recording)
+    {
+	ReplayStep rs = { time, keys,
+	    Uint8((input ? Replay::RF_INPUT : 0) |
+		    (invuln ? Replay::RF_INVULN : 0)),
+	    turnRateFactor };
+	recording->add(rs);
+    }
+
+    step(time, keys, input, !noInput);
+}
+
+void GameState::replayStep(const ReplayStep& rs)
+{
+    if (rs.flags & Replay::RF_END)
+    {
+	end = EndState(rs.keys);
+	return;
+    }
+    if (rs.time <= 0)
+	return;
+
+    invuln = rs.flags & Replay::RF_INVULN;
+    turnRateFactor = rs.turnRateFactor;
+    step(rs.time, rs.keys, rs.flags & Replay::RF_INPUT, false);
+}
+
+void GameState::forceEnd(EndState how)
+{
+    end = how;
+    if (recording)
+    {
+	ReplayStep rs = { 0, Uint8(how), Replay::RF_END, turnRateFactor };
+	recording->add(rs);
+    }
+}
+
+void GameState::step(int time, Uint8 keys, bool input, bool viewInput)
+{
+    deadShots = false;
+    nodeOwnership.events.clear();
+
     updateObjects(time);
 
     if (freeViewMode)
     {
-	if (!noInput)
+	if (viewInput)
 	    handleFreeViewInput(time);
     }
     else
     {
-	if ( (!noInput || ai) && !you.dead)
-	    handleGameInput(time);
+	if (input && !you.dead)
+	    handleGameInput(time, keys);
 	updateZoom(time);
     }
 
     evilAI(time);
 
-    soundEvents.update(RelPolarCoord(you.aim.angle, zoomdist));
-
     cleanup();
 }
 
+// updateSpirallers: move all the plain spiralling invaders in one batch,
+// doing for them what Invader::update would
+void GameState::updateSpirallers(int time)
+{
+    spiralBatch.clear();
+    spiralIndex.clear();
+    for (unsigned int i = 0; i < invaders.size(); i++)
+    {
+	const SpirallingInvader* sp = invaders.spiraller[i];
+	if (sp)
+	{
+	    spiralIndex.push_back(i);
+	    spiralBatch.add(sp->pos.angle, sp->pos.dist, sp->ds, sp->dd,
+		    sp->focus.x, sp->focus.y);
+	}
+    }
+
+    spiralBatch.step(time);
+
+    for (int k = 0; k < spiralBatch.size(); k++)
+    {
+	const int i = spiralIndex[k];
+	SpirallingInvader* sp = invaders.spiraller[i];
+	sp->pos.angle = spiralBatch.angle[k];
+	sp->pos.dist = spiralBatch.dist[k];
+	invaders[i]->setCollTrajectory(
+		CartCoord(spiralBatch.startX[k], spiralBatch.startY[k]),
+		RelCartCoord(spiralBatch.velX[k], spiralBatch.velY[k]));
+    }
+}
+
 void GameState::updateObjects(int time)
 {
     you.update(time, youHaveNode(NODEC_CYAN));
@@ -302,85 +364,98 @@ void GameState::updateObjects(int time)
     {
 	it->update(time);
 
-	if (it->status == NODEST_EVIL)
+	if (it->status() == NODEST_EVIL)
 	{
 	    extracted += it->extract(time, evilHasNode(NODEC_CYAN));
 	    if (extracted > extractMax && mutilationWave == -1)
 	    // initiate wave of mutilation
 		mutilationWave = ARENA_RAD;
 	}
-	else if (it->status == NODEST_DESTROYED)
+	else if (it->status() == NODEST_DESTROYED)
 	    destroyedCount++;
     }
     if (destroyedCount >= 4 && end == END_NOT)
     {
 	// you win - set invaders fleeing away
 	end = END_WIN;
-	for (std::vector<Invader*>::iterator it = invaders.begin();
-		it != invaders.end();
-		it++)
-	    (*it)->fleeOnWin();
+	for (unsigned int i = 0; i < invaders.size(); i++)
+	    invaders[i]->fleeOnWin();
     }
 
     updateMutilation(time);
 
-    std::vector<Invader*> topush;
+    spawned.clear();
 
-    for (std::vector<Invader*>::iterator it = invaders.begin();
-	    it != invaders.end();
-	    it++)
-    {
-	Invader* inv = *it;
-	inv->update(time);
+    updateSpirallers(time);
 
-	while (!inv->spawns.empty())
-	{
-	    Invader* spawned = inv->spawns.back();
-	    inv->spawns.pop_back();
-	    topush.push_back(spawned);
-	}
-
-	if (inv->hitsYou() &&
-		inv->collObj().circleIntersects(ARENA_CENTRE, you.radius()))
+    const float youRadius = you.radius();
+    for (unsigned int i = 0; i < invaders.size(); i++)
+    {
+	Invader* inv = invaders[i];
+	if (!invaders.spiraller[i])
+	    inv->update(time);
+	invaders.record(i, time);
+
+	for (int j = 0; j < inv->numSpawns; j++)
+	    spawned.push_back(new (pools) EggInvader(inv->spawns[j].pos,
+			inv->spawns[j].ds));
+	inv->numSpawns = 0;
+
+	const RelCartCoord startDisp =
+	    invaders.pos[i] - invaders.vel[i]*time - ARENA_CENTRE;
+	const float reach = youRadius + invaders.radius[i];
+	if ((invaders.flags[i] & InvaderStore::IF_HITSYOU) &&
+		startDisp.lengthsq() <= reach*reach &&
+		inv->collObj().circleIntersects(ARENA_CENTRE, youRadius))
 	{
 	    inv->die();
 	    if (!you.dead)
 	    {
-		soundEvents.newEvent(inv->cpos()-ARENA_CENTRE, shieldChunk,
+		sounds.push(inv->cpos()-ARENA_CENTRE, SOUND_SHIELD,
 			96, 1000 + 100*int(you.shield)); 
 		you.shield -= 1;
-		if (you.shield < 0 && !settings.invuln)
+		if (you.shield < 0 && !invuln)
 		    you.dead = true;
 	    }
 	}
 
 	// check for leaving arena
-	if (((inv)->cpos() - ARENA_CENTRE).lengthsq() >=
+	if ((invaders.pos[i] - ARENA_CENTRE).lengthsq() >=
 		ARENA_RAD*ARENA_RAD)
 	    inv->die();
     }
 
-    // check for collisions between invaders
     // (note that this must come after updating all invaders, since we need
     // the collision objects to be set)
-    for (std::vector<Invader*>::iterator it = invaders.begin();
-	    it != invaders.end();
-	    it++)
+    invaderGrid.clear(ARENA_CENTRE, ARENA_RAD);
+    for (unsigned int i = 0; i < invaders.size(); i++)
+    {
+	const RelCartCoord halfSweep = invaders.vel[i]*(time/2.0f);
+	invaderGrid.insert(i, invaders.pos[i] - halfSweep,
+		invaders.radius[i] + sqrt(halfSweep.lengthsq()));
+    }
+
+    // check for collisions between invaders
+    for (unsigned int i = 0; i < invaders.size(); i++)
     {
-	Invader* inv = *it;
-	if (inv->hitsInvaders() > 0)
+	if (invaders.hitsInvaders[i] > 0)
 	{
+	    Invader* inv = invaders[i];
 	    Invader* hitInvader = NULL;
-	    const float r = inv->hitsInvaders();
-	    for (std::vector<Invader*>::iterator it2 = invaders.begin();
-		    it2 != invaders.end();
-		    it2++)
+	    const float r = invaders.hitsInvaders[i];
+	    const CartCoord c = invaders.pos[i];
+	    invaderGrid.query(c, r, gridFound);
+	    for (std::vector<int>::iterator foundit = gridFound.begin();
+		    foundit != gridFound.end();
+		    foundit++)
 	    {
-		if (*it2 == inv)
+		Invader* other = invaders[*foundit];
+		if (other == inv)
 		    continue;
-		if ((*it2)->collObj().circleIntersects(inv->cpos(), r))
+		collisionTests++;
+		if (other->collObj().circleIntersects(c, r))
 		{
-		    hitInvader = *it2;
+		    hitInvader = other;
 		    break;
 		}
 	    }
@@ -390,9 +465,9 @@ void GameState::updateObjects(int time)
 		int damage = hitInvader->die();
 		if (hitInvader->dead())
 		{
-		    soundEvents.newEvent(hitInvader->cpos() - ARENA_CENTRE,
-			    invDieChunk,
-			    96, 800+200*damage + int(100*gaussian()));
+		    sounds.push(hitInvader->cpos() - ARENA_CENTRE,
+			    SOUND_INVDIE,
+			    96, 800+200*damage + int(100*rng.gaussian()));
 		    you.score += hitInvader->killScore();
 		}
 		inv->hit(damage);
@@ -406,20 +481,24 @@ void GameState::updateObjects(int time)
     {
 	float hitTime = -1;
 	Invader* hitInvader = NULL;
+	const RelCartCoord v = it->vel;
 
-	for (std::vector<Invader*>::iterator invit = invaders.begin();
-		invit != invaders.end();
-		invit++)
+	// only invaders sharing a grid cell with the shot's path can be hit
+	invaderGrid.query(it->pos, v, time, gridFound);
+	for (std::vector<int>::iterator foundit = gridFound.begin();
+		foundit != gridFound.end();
+		foundit++)
 	{
-	    if (!(*invit)->hitsShots())
+	    if (!(invaders.flags[*foundit] & InvaderStore::IF_HITSSHOTS))
 		continue;
+	    Invader* inv = invaders[*foundit];
 
-	    RelCartCoord v = it->vel;
-	    float t = (*invit)->collObj().pointHits(it->pos, v, time);
+	    collisionTests++;
+	    float t = inv->collObj().pointHits(it->pos, v, time);
 	    if (t >= 0 && (hitTime == -1 || t < hitTime))
 	    {
 		hitTime = t;
-		hitInvader = *invit;
+		hitInvader = inv;
 	    }
 	}
 	for (std::vector<Node>::iterator nodeit = nodes.begin();
@@ -429,7 +508,7 @@ void GameState::updateObjects(int time)
 	    if (nodeit->primed < 1)
 		continue;
 
-	    RelCartCoord v = it->vel;
+	    collisionTests++;
 	    float t = nodeit->collObj().pointHits(it->pos, v, time);
 	    if (t >= 0 && (hitTime == -1 || t < hitTime))
 	    {
@@ -443,13 +522,13 @@ void GameState::updateObjects(int time)
 	    int damage = hitInvader->hit(it->weight);
 	    if (hitInvader->dead())
 	    {
-		soundEvents.newEvent(it->pos - ARENA_CENTRE, invDieChunk,
-			96, 800+200*damage + int(100*gaussian()));
+		sounds.push(it->pos - ARENA_CENTRE, SOUND_INVDIE,
+			96, 800+200*damage + int(100*rng.gaussian()));
 		you.score += hitInvader->killScore();
 	    }
 	    else
-		soundEvents.newEvent(it->pos - ARENA_CENTRE, invHitChunk,
-			96, 800+200*damage + int(100*gaussian()));
+		sounds.push(it->pos - ARENA_CENTRE, SOUND_INVHIT,
+			96, 800+200*damage + int(100*rng.gaussian()));
 	    it->hit(damage);
 	    if (Shot::is_dead(*it))
 		deadShots = true;
@@ -465,54 +544,45 @@ void GameState::updateObjects(int time)
     }
 
     // add newly spawned invaders
-    for (std::vector<Invader*>::iterator it = topush.begin();
-	    it != topush.end();
+    for (std::vector<Invader*>::iterator it = spawned.begin();
+	    it != spawned.end();
 	    it++)
     {
-	invaders.push_back(*it);
+	invaders.add(*it);
     }
 }
 
-void GameState::handleGameInput(int time)
+// keyboardKeys: the game keys currently held, encoded as for AI::keys
+Uint8 GameState::keyboardKeys()
 {
-    bool keyRotLeft;
-    bool keyRotRight;
-    bool keyDeAim;
-    bool keyDeZoom;
-    bool keyShoot1;
-    bool keyShoot2;
-    bool keyShoot3;
-    bool keyShootPod;
-
-    if (!ai)
-    {
-	keyRotLeft = settings.keybindings[C_LEFT].isPressed();
-	keyRotRight = settings.keybindings[C_RIGHT].isPressed();
-	keyDeAim = settings.keybindings[C_DEAIM].isPressed();
-	keyDeZoom = settings.keybindings[C_DEZOOM].isPressed();
-	keyShoot1 = settings.keybindings[C_SHOOT_GREEN].isPressed();
-	keyShoot2 = settings.keybindings[C_SHOOT_YELLOW].isPressed();
-	keyShoot3 = settings.keybindings[C_SHOOT_RED].isPressed();
-	keyShootPod = settings.keybindings[C_SHOOT_POD].isPressed();
-    }
-    else
-    {
-	keyRotLeft = ai->keys & ai->K_LEFT;
-	keyRotRight = ai->keys & ai->K_RIGHT;
-	keyDeAim = ai->keys & ai->K_DEAIM;
-	keyDeZoom = ai->keys & ai->K_DEZOOM;
-	keyShoot1 = ai->keys & ai->K_SHOOT1;
-	keyShoot2 = ai->keys & ai->K_SHOOT2;
-	keyShoot3 = ai->keys & ai->K_SHOOT3;
-	keyShootPod = ai->keys & ai->K_POD;
-    }
+    return
+	(settings.keybindings[C_LEFT].isPressed() ? AI::K_LEFT : 0) |
+	(settings.keybindings[C_RIGHT].isPressed() ? AI::K_RIGHT : 0) |
+	(settings.keybindings[C_DEAIM].isPressed() ? AI::K_DEAIM : 0) |
+	(settings.keybindings[C_DEZOOM].isPressed() ? AI::K_DEZOOM : 0) |
+	(settings.keybindings[C_SHOOT_GREEN].isPressed() ? AI::K_SHOOT1 : 0) |
+	(settings.keybindings[C_SHOOT_YELLOW].isPressed() ? AI::K_SHOOT2 : 0) |
+	(settings.keybindings[C_SHOOT_RED].isPressed() ? AI::K_SHOOT3 : 0) |
+	(settings.keybindings[C_SHOOT_POD].isPressed() ? AI::K_POD : 0);
+}
+
+void GameState::handleGameInput(int time, Uint8 keys)
+{
+    const bool keyRotLeft = keys & AI::K_LEFT;
+    const bool keyRotRight = keys & AI::K_RIGHT;
+    const bool keyDeAim = keys & AI::K_DEAIM;
+    const bool keyDeZoom = keys & AI::K_DEZOOM;
+    const bool keyShoot1 = keys & AI::K_SHOOT1;
+    const bool keyShoot2 = keys & AI::K_SHOOT2;
+    const bool keyShoot3 = keys & AI::K_SHOOT3;
+    const bool keyShootPod = keys & AI::K_POD;
 
     if (keyRotLeft || keyRotRight)
     {
 	if (keyRotLeft)
-	    you.aim.angle += time*.015*settings.turnRateFactor*you.aimAccuracy();
+	    you.aim.angle += time*.015*turnRateFactor*you.aimAccuracy();
 	else
-	    you.aim.angle += time*-.015*settings.turnRateFactor*you.aimAccuracy();
+	    you.aim.angle += time*-.015*turnRateFactor*you.aimAccuracy();
 	you.aim.dist = std::max(AIM_MIN, (float)(you.aim.dist-time*.04));
     }
     if (keyDeAim)
@@ -541,7 +611,7 @@ void GameState::handleGameInput(int time)
     {
 	Angle relAngle = you.aim.angle - it->pos.angle;
 	const float dtheta = std::min(float(relAngle), 4.0f-relAngle);
-	if (it->status != NODEST_DESTROYED &&
+	if (it->status() != NODEST_DESTROYED &&
 		dtheta < mintheta)
 	{
 	    mintheta = dtheta;
@@ -579,7 +649,7 @@ void GameState::handleGameInput(int time)
 	}
 	if (weight > 0)
 	{
-	    float noise = gaussian()*you.aimAccuracy();
+	    float noise = rng.gaussian()*you.aimAccuracy();
 
 	    Shot shot( ARENA_CENTRE,
 		    RelPolarCoord(you.aim.angle+noise,
@@ -596,11 +666,11 @@ void GameState::handleGameInput(int time)
 
 	    shots.push_back(shot);
 
-	    const int pitch = 900+weight*100 + int(40*gaussian());
-	    soundEvents.newEvent(shot.pos-ARENA_CENTRE, shotChunk,
+	    const int pitch = 900+weight*100 + int(40*rng.gaussian());
+	    sounds.push(shot.pos-ARENA_CENTRE, SOUND_SHOT,
 		    32, pitch);
 	    if (super)
-		soundEvents.newEvent(shot.pos-ARENA_CENTRE, shotChunk,
+		sounds.push(shot.pos-ARENA_CENTRE, SOUND_SHOT,
 			32, pitch*3/4);
 
 	    you.shootHeat += shotHeat(weight-1);
@@ -618,18 +688,18 @@ void GameState::handleGameInput(int time)
 	    you.shootHeat < you.shootMaxHeat - shotHeat(3))
     {
 	const bool super = youHaveNode(NODEC_BLUE);
-	invaders.push_back(new CapturePod(targettedNode,
+	invaders.add(new (pools) CapturePod(targettedNode,
 		    RelPolarCoord(you.aim.angle, 5),
 		    super));
 	you.podTimer = shotDelay(3);
 	you.shootHeat += shotHeat(3);
 	you.doneLaunchedPod = true;
 
-	const int pitch = 1500 + int(40*gaussian());
-	soundEvents.newEvent(0, shotChunk,
+	const int pitch = 1500 + int(40*rng.gaussian());
+	sounds.push(0, SOUND_SHOT,
 		32, pitch);
 	if (super)
-	    soundEvents.newEvent(0, shotChunk,
+	    sounds.push(0, SOUND_SHOT,
 		    32, pitch*3/4);
     }
 
@@ -655,7 +725,8 @@ void GameState::handleFreeViewInput(int time)
     bool keyRotLeft = settings.keybindings[C_SHOOT_RED].isPressed();
     bool keyRotRight = settings.keybindings[C_SHOOT_POD].isPressed();
 
-    const float baseZoom = (float)screenGeom.rad / (float)ARENA_RAD;
+    // freeView.zoom is relative to the whole arena filling the screen
+    const float baseZoom = 1;
     const float maxZoom = baseZoom * 32;
     const float minZoom = baseZoom;
     bool moved = false;
@@ -681,10 +752,10 @@ void GameState::handleFreeViewInput(int time)
     RelPolarCoord freeViewCentre = freeView.centre - ARENA_CENTRE;
     if (moved)
 	freeView.zoom = std::max(freeView.zoom,
-		(float)screenGeom.rad / ((float)ARENA_RAD - freeViewCentre.dist));
+		(float)ARENA_RAD / ((float)ARENA_RAD - freeViewCentre.dist));
     freeView.zoom = std::min(maxZoom, std::max(minZoom, freeView.zoom));
     freeViewCentre.dist = std::min(freeViewCentre.dist,
-	    (float)ARENA_RAD - ((float)screenGeom.rad / freeView.zoom));
+	    (float)ARENA_RAD - ((float)ARENA_RAD / freeView.zoom));
     freeView.centre = ARENA_CENTRE + freeViewCentre;
 }
 
@@ -705,8 +776,7 @@ void GameState::updateZoom(int time)
     if (end == END_DEAD || end == END_EXTRACTED && zoomdist < 1)
     {
 	freeViewMode = true;
-	freeView = View(ARENA_CENTRE,
-		(float)screenGeom.rad / (float)ARENA_RAD, -you.aim.angle);
+	freeView = View(ARENA_CENTRE, 1, -you.aim.angle);
     }
 }
 
@@ -715,15 +785,15 @@ void GameState::evilAI(int time)
     invaderCooldown -= time;
     if (end != END_WIN &&
 	    invaderCooldown <= 0 &&
-	    rani(invaderRate/3) <= time)
+	    rng.rani(invaderRate/3) <= time)
     {
 	// it's about time to spawn a new invader
 	Invader* p_inv = NULL;
 	int cost = 0;
 	while (cost == 0)
 	{
-	    //int type = rani(5) == 0 ? 3 : rani(3);
-	    int type = rani(4);
+	    //int type = rng.rani(5) == 0 ? 3 : rng.rani(3);
+	    int type = rng.rani(4);
 	    if (mutilationWave > -1)
 		type = 3;
 	    RelPolarCoord pos;
@@ -737,16 +807,16 @@ void GameState::evilAI(int time)
 				type == 1 ? NODEC_YELLOW :
 				NODEC_GREEN);
 			cost = 1;
-			pos = RelPolarCoord(ranf()*4, ARENA_RAD-20);
-			ds = super ? rani(9)-4 : rani(5)-2;
+			pos = RelPolarCoord(rng.ranf()*4, ARENA_RAD-20);
+			ds = super ? rng.rani(9)-4 : rng.rani(5)-2;
 			switch (type)
 			{
-			    case 0: p_inv = new EggInvader(pos, ds, super);
-				    break;
-			    case 1: p_inv = new KamikazeInvader(pos, ds,
-					    super); break;
-			    case 2: p_inv = new SplittingInvader(pos, ds,
+			    case 0: p_inv = new (pools) EggInvader(pos, ds,
 					    super); break;
+			    case 1: p_inv = new (pools) KamikazeInvader(rng,
+					    pos, ds, super); break;
+			    case 2: p_inv = new (pools) SplittingInvader(rng,
+					    pos, ds, super); break;
 			}
 			break;
 		    }
@@ -759,45 +829,44 @@ void GameState::evilAI(int time)
 			// actually spawned.
 			cost = 3;
 
-			std::vector<Node*> possibleTargets;
+			possibleTargets.clear();
 			for (std::vector<Node>::iterator it = nodes.begin();
 				it != nodes.end();
 				it++)
 			{
-			    if ((it->status == NODEST_NONE ||
-					it->status == NODEST_YOU) &&
+			    if ((it->status() == NODEST_NONE ||
+					it->status() == NODEST_YOU) &&
 				    it->targettingInfester == NULL)
 				possibleTargets.push_back(&*it);
 			}
 			if (possibleTargets.size() > 0)
 			{
-			    const int i = rani(possibleTargets.size());
-			    p_inv = new InfestingInvader(possibleTargets[i],
-				    evilHasNode(NODEC_BLUE));
+			    const int i = rng.rani(possibleTargets.size());
+			    p_inv = new (pools) InfestingInvader(rng,
+				    possibleTargets[i], evilHasNode(NODEC_BLUE));
 			}
 		    }
 		    break;
 		case 4:
 		    // FoulEggLayingInvader - unused
 		    cost = 1;
-		    pos = RelPolarCoord(ranf()*4, ARENA_RAD-(20+rani(5)*10));
-		    ds = rani(5)-2;
-		    p_inv = new FoulEggLayingInvader(pos, ds);
+		    pos = RelPolarCoord(rng.ranf()*4,
+			    ARENA_RAD-(20+rng.rani(5)*10));
+		    ds = rng.rani(5)-2;
+		    p_inv = new (pools) FoulEggLayingInvader(pos, ds);
 		    break;
 	    }
 	}
 	if (p_inv)
-	    invaders.push_back(p_inv);
+	    invaders.add(p_inv);
 	invaderCooldown += invaderRate * cost;
     }
 
     if (evilHasNode(NODEC_PURPLE) &&
-	    rani(7500) < time)
+	    rng.rani(7500) < time)
     {
-	for (std::vector<Invader*>::iterator it = invaders.begin();
-		it != invaders.end();
-		it++)
-	    (*it)->dodge();
+	for (unsigned int i = 0; i < invaders.size(); i++)
+	    invaders[i]->dodge();
     }
 }
 
@@ -810,20 +879,7 @@ void GameState::cleanup()
 		shots.end());
     }
 
-    for (std::vector<Invader*>::iterator it = invaders.begin();
-	    it != invaders.end();
-	    it++)
-    {
-	if ((*it)->dead())
-	{
-	    (*it)->onDeath();
-	    delete *it;
-	    (*it) = NULL;
-	}
-    }
-    invaders.erase(remove_if(invaders.begin(),
-		invaders.end(), isNullInvp),
-	    invaders.end());
+    invaders.removeDead();
 }
 
 void GameState::draw(SDL_Surface* surface)
@@ -831,6 +887,10 @@ void GameState::draw(SDL_Surface* surface)
     View view;
     View boundView;
 
+    // primitives are recorded and drawn together at the end; the raw
+    // SDL_gfx calls below draw straight away, beneath them
+    drawList.open(surface);
+
     if (!freeViewMode)
     {
 	const RelPolarCoord d(you.aim.angle, zoomdist);
@@ -860,7 +920,8 @@ void GameState::draw(SDL_Surface* surface)
     }
     else
     {
-	boundView = view = freeView;
+	boundView = view = View(freeView.centre,
+		freeView.zoom*screenGeom.rad/ARENA_RAD, freeView.angle);
 	boundView.zoom /= 3;
 
 	((settings.useAA == AA_FORCE) ? aacircleColor : circleColor)
@@ -870,9 +931,14 @@ void GameState::draw(SDL_Surface* surface)
 
     drawIndicators(surface, view);
     drawGrid(surface, view);
+    drawList.newLayer();
     drawTargettingLines(surface, view);
+    drawList.newLayer();
     drawObjects(surface, view, &boundView);
+    drawList.newLayer();
     drawNodeTargetting(surface, view);
+
+    drawList.flush();
 }
 
 void GameState::drawGrid(SDL_Surface* surface, const View& view)
@@ -947,10 +1013,15 @@ void GameState::drawObjects(SDL_Surface* surface, const View& view,
 	    it++)
 	it->draw(surface, view, boundView);
 
-    for (std::vector<Invader*>::iterator it = invaders.begin();
-	    it != invaders.end();
-	    it++)
-	(*it)->draw(surface, view, boundView);
+    for (unsigned int i = 0; i < invaders.size(); i++)
+    {
+	// skip invaders wholly outside the bounding view without asking
+	// them to draw themselves
+	if (boundView && !boundView->inView(invaders.pos[i],
+		    -(invaders.radius[i]+2)*boundView->zoom))
+	    continue;
+	invaders[i]->draw(surface, view, boundView);
+    }
 
     for (std::vector<Node>::iterator it = nodes.begin();
 	    it != nodes.end();
@@ -968,134 +1039,19 @@ void GameState::drawObjects(SDL_Surface* surface, const View& view,
 		).draw(surface, view, NULL);
 }
 
-// approxAtan2Frac: approximates atan2(y,x)*(6/PI)-1
-//  (being the linear function of atan2(y,x) which is 0 at PI/6 and 1 at PI/3)
-float approxAtan2Frac(int y, int x)
-{
-    static const int N = 10;
-    static const float left=0.5, right=2.0;
-    static float z0[N];
-    static float t0[N], t1[N];
-    static const float halfDist = (right-left)/(2*(N-1));
-    static bool preCalced=false;
-
-    if (!preCalced)
-    {
-	// calculate first two terms of the Taylor expansion around some
-	// values of z spaced uniformly along the interval
-	for (int i = 0; i < N; i++)
-	{
-	    z0[i] = left + (right-left)*i/(N-1);
-
-	    t0[i] = atan(z0[i])*(6.0/PI)-1;
-	    t1[i] = (1.0/(1+z0[i]*z0[i]))*(6.0/PI);
-	}
-	preCalced = true;
-    }
-
-    float z = float(y)/x;
-
-    // use the precalculated linear approximation around the closest z value
-    for (int i = 0; i < N; i++)
-	if ( i == N-1 || z < z0[i] + halfDist )
-	    return t0[i] + t1[i]*(z-z0[i]);
-
-    return 0; // won't happen
-
-    // cubic approximation to atan(z) around z=1:
-    // return PI/4 + (z-1)/2 - (z-1)*(z-1)/4 + (z-1)*(z-1)*(z-1)/12;
-}
-
 void GameState::drawIndicators(SDL_Surface* surface, const View& view)
 {
     // heat, shield and extraction indicators:
-    Uint32 colour;
-    for (int x = screenGeom.rad/2;
-	    x <= 866*screenGeom.rad/1000 + 15;
-	    x++)
-    {
-	const int xsq = x*x;
-	int rsq;
-	for (int y = int(sqrt(screenGeom.indicatorRsqLim1 - xsq));
-		(rsq = xsq + y*y) <= screenGeom.indicatorRsqLim4;
-		y++)
-	{
-	    if (rsq < screenGeom.indicatorRsqLim1)
-		continue;
-	    const float frac = approxAtan2Frac(y,x);
-	    if (frac >= 0 && frac <= 1)
-	    {
-		if (rsq <= screenGeom.indicatorRsqLim2)
-		{
-		    // decay towards the edges, for prettiness
-		    const int decay = std::min(255,
-			    std::min(rsq - screenGeom.indicatorRsqLim1,
-				screenGeom.indicatorRsqLim2 - rsq)/2);
-		    int intensity;
-
-		    // heat
-		    intensity = 
-			you.shootHeat > you.shootMaxHeat*frac ? 55+int(200*frac) :
-			(frac >= 0.98 ? int(5000*(frac-0.98)) : 0) + (
-				35 );
-		    colour = 0x01000000 * intensity + decay;
-
-		    pixelColor(surface, screenGeom.centre.x - x,
-			    screenGeom.centre.y - y, colour);
-
-		    // extraction
-		    if (extracted <= extractPreMutCutoff)
-			intensity =
-			    extracted > extractPreMutCutoff*frac ? 55+int(200*frac) :
-			    (frac >= 0.98 ? int(5000*(frac-0.98)) : 0) + (
-				    evilHasNode(NODEC_CYAN) ? 55 : 35 );
-		    else
-			intensity =
-			    ((extracted - extractPreMutCutoff) >
-			     (extractMax - extractPreMutCutoff)*frac) ?
-			    85+int(170*frac) :
-			    (frac >= 0.98 ? int(5000*(frac-0.98)) : 0) + (
-				    evilHasNode(NODEC_CYAN) ? 85 : 60 );
-		    colour = 0x00010100 * intensity + decay;
-
-		    pixelColor(surface, screenGeom.centre.x + x,
-			    screenGeom.centre.y - y, colour);
-		}
-		else if (rsq < screenGeom.indicatorRsqLim3)
-		{
-		    // shade between heat and shield indicators
-		    pixelColor(surface, screenGeom.centre.x - x,
-			    screenGeom.centre.y - y, 0xa0);
-		}
-		else
-		{
-		    const int decay = std::min(255,
-			    std::min(rsq - screenGeom.indicatorRsqLim3,
-				screenGeom.indicatorRsqLim4 - rsq)/2);
-		    int intensity;
-
-		    // shield
-		    const int i = int(frac*4);
-		    const Uint32 baseColour =
-			(i == 0) ? 0x01000000 :
-			(i == 1) ? 0x01010000 :
-			(i == 2) ? 0x00010000 :
-			0x00010100;
-
-		    intensity =
-			(you.shield > frac*4) ? 55+(int(4*200*frac))%200 :
-			youHaveNode(NODEC_CYAN) ? 55 :
-			35;
-
-		    colour =
-			baseColour * intensity + decay;
-
-		    pixelColor(surface, screenGeom.centre.x - x,
-			    screenGeom.centre.y - y, colour);
-		}
-	    }
-	}
-    }
+    IndicatorState state;
+    state.shootHeat = you.shootHeat;
+    state.shootMaxHeat = you.shootMaxHeat;
+    state.extracted = extracted;
+    state.extractPreMutCutoff = extractPreMutCutoff;
+    state.extractMax = extractMax;
+    state.shield = you.shield;
+    state.evilHasCyan = evilHasNode(NODEC_CYAN);
+    state.youHaveCyan = youHaveNode(NODEC_CYAN);
+    indicatorRing.draw(surface, state);
 
     // shot indicators
     static const double shotIndicatorCos = cos(PI/6-PI/120);
@@ -1143,22 +1099,24 @@ void GameState::drawIndicators(SDL_Surface* surface, const View& view)
 	    it != nodes.end();
 	    it++)
     {
-	if (it->status == NODEST_YOU)
+	if (it->status() == NODEST_YOU)
 	{
 	    const View nodeView(CartCoord(
 			nodeIndicatorCos[youNodeCount] * dist,
 			- nodeIndicatorSin[youNodeCount] * dist),
 		    1, 0);
-	    Node(RelPolarCoord(0,0), 0, it->nodeColour).draw(surface, nodeView, NULL);
+	    Node(drawRng, RelPolarCoord(0,0), 0, it->nodeColour).draw(surface,
+		    nodeView, NULL);
 	    youNodeCount++;
 	}
-	else if (it->status == NODEST_EVIL)
+	else if (it->status() == NODEST_EVIL)
 	{
 	    const View nodeView(CartCoord(
 			- nodeIndicatorCos[evilNodeCount] * dist,
 			- nodeIndicatorSin[evilNodeCount] * dist),
 		    1, 0);
-	    Node(RelPolarCoord(0,0), 0, it->nodeColour).draw(surface, nodeView, NULL);
+	    Node(drawRng, RelPolarCoord(0,0), 0, it->nodeColour).draw(surface,
+		    nodeView, NULL);
 	    evilNodeCount++;
 	}
     }
@@ -1176,9 +1134,10 @@ int GameState::rateOfRating(int rating)
     return rates[rating-1];
 }
 
-void GameState::setRating()
+void GameState::setRating(double requestedRating)
 {
-    double newRating = settings.requestedRating > 0 ?
+    double newRating = requestedRating > 0 ? requestedRating :
+	settings.requestedRating > 0 ?
 	settings.requestedRating : config.rating[speed];
     if (newRating < 1.0)
 	newRating = 1.0;
@@ -1235,7 +1194,7 @@ const char* GameState::getHint()
 	    for (std::vector<Node>::iterator it = nodes.begin();
 		    it != nodes.end();
 		    it++)
-		if (it->status == NODEST_DESTROYED)
+		if (it->status() == NODEST_DESTROYED)
 		{
 		    destroyed = true;
 		    break;
@@ -8,6 +8,11 @@
 #include "invaders.h"
 #include "player.h"
 #include "node.h"
+#include "indicator.h"
+#include "spiral.h"
+#include "random.h"
+#include "replay.h"
+#include "sound.h"
 
 #include <vector>
 
@@ -31,15 +36,44 @@ class GameState
     friend class BasicAI;
     private:
 	std::vector<Shot> shots;
-	std::vector<Invader*> invaders;
+
+	// pools: where this game's invaders are allocated; declared before
+	// 'invaders', so as to outlive them
+	PoolArena pools;
+	InvaderStore invaders;
 	std::vector<Node> nodes;
 
+	// nodeOwnership: who holds which nodes; its events are those of the
+	// current step
+	NodeOwnership nodeOwnership;
+
+	// broad-phase index of this step's invader trajectories, by index
+	// into 'invaders'; rebuilt in updateObjects
+	CollisionGrid invaderGrid;
+	std::vector<int> gridFound;
+
+	// scratch lists reused between steps, so that their storage is
+	// allocated only once
+	std::vector<Invader*> spawned;
+	std::vector<Node*> possibleTargets;
+
+	// spiralBatch: the motion of the plain spirallers among the invaders,
+	// integrated together each step; spiralIndex maps entries back to
+	// indices into 'invaders'
+	SpiralBatch spiralBatch;
+	std::vector<int> spiralIndex;
+	void updateSpirallers(int time);
+
 	Node* targettedNode;
 	int invaderCooldown;
 
-	bool youHaveNode(NodeColour colour);
-	bool youHaveShotNode(int type);
-	bool evilHasNode(NodeColour colour);
+	IndicatorRing indicatorRing;
+
+	bool youHaveNode(NodeColour colour) const
+	{ return nodeOwnership.youHave(colour); }
+	bool youHaveShotNode(int type) const;
+	bool evilHasNode(NodeColour colour) const
+	{ return nodeOwnership.evilHas(colour); }
 
 	int shotHeat(int type);
 	int shotDelay(int type);
@@ -51,7 +85,12 @@ class GameState
 
 	int rateOfRating(int rating);
 	void updateObjects(int time);
-	void handleGameInput(int time);
+	// step: advance the game given the input; 'input' says whether keys
+	// apply at all, 'viewInput' whether to read the keyboard for free
+	// view mode
+	void step(int time, Uint8 keys, bool input, bool viewInput);
+	Uint8 keyboardKeys();
+	void handleGameInput(int time, Uint8 keys);
 	void handleFreeViewInput(int time);
 	void updateZoom(int time);
 	void evilAI(int time);
@@ -59,6 +98,8 @@ class GameState
 	void cleanup();
 
 	bool freeViewMode;
+	// freeView: the view in free view mode, with zoom 1 showing the whole
+	// arena, whatever the size of the screen
 	View freeView;
 
 	void drawGrid(SDL_Surface* surface, const View& view);
@@ -81,13 +122,44 @@ class GameState
 
 	AI* ai;
 
-	void setRating();
+	// seed: the seed of rng; a game is determined by its seed, settings
+	// and input
+	const Uint32 seed;
+	// rng: randomness for the game itself; drawRng: for decoration made
+	// while drawing, kept apart so that drawing can't change the game
+	Random rng;
+	Random drawRng;
+
+	// collisionTests: number of exact collision tests made (i.e. those
+	// which got past the broad phase) over the course of the game
+	unsigned long collisionTests;
+
+	// invuln, turnRateFactor: as the settings, which are copied at each
+	// update, or as recorded when replaying
+	bool invuln;
+	float turnRateFactor;
+
+	// recording: if non-NULL, the input of each step is added to it
+	Replay* recording;
+
+	// sounds: the sounds triggered by the game, for the audio stage to
+	// play if sound is on when it drains them; disabled for headless and
+	// farm games, which nobody hears
+	SoundQueue sounds;
+
+	// setRating: set rating, and hence invader rate, from
+	// 'requestedRating' if positive, else from the settings and config
+	void setRating(double requestedRating=0);
 	void update(int time, bool noInput=false);
+	// replayStep: take a step recorded in a replay
+	void replayStep(const ReplayStep& step);
+	// forceEnd: end the game from outside, e.g. on surrender
+	void forceEnd(EndState how);
 	void draw(SDL_Surface* surface);
 
 	const char* getHint();
 
-	GameState(int speed);
+	GameState(int speed, Uint32 seed, double requestedRating=0);
 };
 
 const char* ratingString(int rating);
@@ -0,0 +1,90 @@
+/*
+ * Kuklomenos
+ * Copyright (C) 2008-2009 Martin Bays <mbays@sdf.lonestar.org>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+
+#include "textcache.h"
+#include "SDL_gfxPrimitivesDirty.h"
+
+#include <string>
+#include <vector>
+#include <SDL/SDL.h>
+
+TextCache textCache;
+
+SDL_Surface* TextCache::get(const std::string& text, const void* font,
+	int cw, int ch, Uint32 colour)
+{
+    uses++;
+
+    unsigned int oldest = 0;
+    for (unsigned int i = 0; i < entries.size(); i++)
+    {
+	Entry& e = entries[i];
+	if (e.font == font && e.colour == colour && e.text == text)
+	{
+	    e.lastUse = uses;
+	    return e.surface;
+	}
+	if (e.lastUse < entries[oldest].lastUse)
+	    oldest = i;
+    }
+
+    gfxPrimitivesSetFont(font, cw, ch);
+    SDL_Surface* surface = stringSurface(text.c_str(), colour);
+    if (surface == NULL)
+	return NULL;
+
+    if (entries.size() < MAX_ENTRIES)
+    {
+	entries.push_back(Entry());
+	oldest = entries.size() - 1;
+    }
+    else
+	SDL_FreeSurface(entries[oldest].surface);
+
+    Entry& e = entries[oldest];
+    e.text = text;
+    e.font = font;
+    e.colour = colour;
+    e.surface = surface;
+    e.lastUse = uses;
+    return surface;
+}
+
+int TextCache::draw(SDL_Surface* surface, int x, int y,
+	const std::string& text, const void* font, int cw, int ch,
+	Uint32 colour)
+{
+    if (text.empty())
+	return 0;
+
+    SDL_Surface* rendered = get(text, font, cw, ch, colour);
+    if (rendered == NULL)
+	return -1;
+
+    SDL_Rect rect;
+    rect.x = x;
+    rect.y = y;
+    return blitDirty(rendered, NULL, surface, &rect);
+}
+
+void TextCache::clear()
+{
+    for (unsigned int i = 0; i < entries.size(); i++)
+	SDL_FreeSurface(entries[i].surface);
+    entries.clear();
+}
@@ -0,0 +1,47 @@
+#ifndef INC_TEXTCACHE_H
+#define INC_TEXTCACHE_H
+
+#include <string>
+#include <vector>
+#include <SDL/SDL.h>
+
+// TextCache: strings rendered to surfaces, keyed on the text, font and
+// colour, so that text which is drawn frame after frame is rendered once and
+// then costs a single blit. The least recently used entry is dropped when
+// the cache is full, so text which changes every frame just cycles through.
+class TextCache
+{
+    private:
+	struct Entry
+	{
+	    std::string text;
+	    const void* font;
+	    Uint32 colour;
+	    SDL_Surface* surface;
+	    unsigned int lastUse;
+	};
+	std::vector<Entry> entries;
+	unsigned int uses;
+
+    public:
+	static const unsigned int MAX_ENTRIES = 64;
+
+	// get: the rendered text, or NULL on failure; the surface belongs to
+	// the cache, and is good until the next call of get or clear
+	SDL_Surface* get(const std::string& text, const void* font,
+		int cw, int ch, Uint32 colour);
+
+	// draw: draw as stringColor would, with top-left at (x,y)
+	int draw(SDL_Surface* surface, int x, int y, const std::string& text,
+		const void* font, int cw, int ch, Uint32 colour);
+
+	// clear: free all entries; called when the screen geometry changes
+	void clear();
+
+	TextCache() : uses(0) {}
+	~TextCache() { clear(); }
+};
+
+extern TextCache textCache;
+
+#endif /* INC_TEXTCACHE_H */